@@ -0,0 +1,371 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include "CircularBuffer.h"
+
+//////////////////////////////////////////////////////////////////////////
+// ClockCache
+//
+//	Provides for a fixed capacity key -> value cache which evicts using the CLOCK algorithm
+//
+//	The cached entries live in a fixed array of slots, and a CircularCounter is the "hand" which
+//	sweeps around that array looking for a victim whose reference count has run out.  Lookups go
+//	through an open addressed (linear probing) index of slot numbers, so a hit is one hash, a probe
+//	or two over a flat array, and bumping the slot's reference count.  There is no list to splice
+//	on every hit as an LRU would require.
+//
+//	max_references = 1 is classic CLOCK (a single reference bit per slot)
+//	max_references > 1 is GCLOCK: frequently hit entries survive up to that many sweeps of the hand
+//
+//	NOTE: ClockCache is not thread safe - see ShardedClockCache for concurrent use
+//
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <
+		typename key_t,
+		typename value_t,
+		size_t capacity,
+		uint8_t max_references = 1,
+		typename hash_t = std::hash<key_t>,
+		typename key_equal_t = std::equal_to<key_t>
+	>
+	class ClockCache
+	{
+	public:
+
+		// NOTE: our hand is a CircularCounter, which requires a non-empty ordered range
+		static_assert(capacity > 1, "ClockCache<> requires a capacity of at least 2");
+		static_assert(max_references > 0, "ClockCache<> requires max_references of at least 1");
+
+		// types
+		using key_type = key_t;
+		using value_type = value_t;
+		using hand_t = CircularCounter<0, capacity - 1>;
+
+		// size (which is static)
+		static constexpr size_t size() { return capacity; }
+
+		// constructors
+		ClockCache() { Reset(); }
+
+		// state
+		bool IsFull() const { return m_count == capacity; }
+		bool IsEmpty() const { return m_count == 0; }
+
+		// attributes
+
+		// returns the number of cached entries
+		size_t GetCount() const { return m_count; }
+
+		void Reset()
+		{
+			m_count = 0;
+			m_hand = hand_t();
+			m_index.fill(kVacant);
+			for (auto & slot : m_slots)
+			{
+				slot.occupied = false;
+				slot.references = 0;
+			}
+		}
+
+		// operations
+
+		// returns the cached value for the given key (or nullptr), and marks that entry as recently referenced
+		// NOTE: the returned pointer is only valid until the next call to Insert() or Erase()
+		value_t * Find(const key_t & key)
+		{
+			const auto position = Lookup(key, m_hasher(key));
+			if (position == kVacant)
+				return nullptr;
+
+			auto & slot = m_slots[m_index[position]];
+			Reference(slot);
+			return &slot.value;
+		}
+
+		// returns true if the given key is cached (without marking it as referenced)
+		bool Contains(const key_t & key) const
+		{
+			return Lookup(key, m_hasher(key)) != kVacant;
+		}
+
+		// caches the given value under key (replacing any existing entry for that key), evicting another entry if we're full
+		// returns a reference to the cached value (valid until the next call to Insert() or Erase())
+		value_t & Insert(const key_t & key, value_t value)
+		{
+			const auto hash = m_hasher(key);
+
+			// replace an existing entry
+			const auto position = Lookup(key, hash);
+			if (position != kVacant)
+			{
+				auto & slot = m_slots[m_index[position]];
+				slot.value = std::move(value);
+				Reference(slot);
+				return slot.value;
+			}
+
+			// claim a slot for a new entry (new entries start unreferenced, so they must be hit to survive the next sweep)
+			const auto victim = Claim();
+			auto & slot = m_slots[victim];
+			slot.key = key;
+			slot.value = std::move(value);
+			slot.hash = hash;
+			slot.references = 0;
+			slot.occupied = true;
+			++m_count;
+
+			Index(victim);
+			return slot.value;
+		}
+
+		// removes the given key from the cache, returns true if it was present
+		bool Erase(const key_t & key)
+		{
+			const auto position = Lookup(key, m_hasher(key));
+			if (position == kVacant)
+				return false;
+
+			Vacate(m_index[position], position);
+			return true;
+		}
+
+	private:
+
+		struct slot_t
+		{
+			key_t		key;
+			value_t		value;
+			size_t		hash;
+			uint8_t		references;
+			bool		occupied;
+		};
+
+		// our index has at least twice as many positions as we have slots, so that probe sequences stay short
+		static constexpr size_t index_size()
+		{
+			size_t n = 1;
+			while (n < capacity * 2)
+				n <<= 1;
+			return n;
+		}
+
+		static constexpr size_t kIndexMask = index_size() - 1;
+		static constexpr size_t kVacant = ~size_t(0);
+
+		// saturating increment of the reference count
+		static void Reference(slot_t & slot)
+		{
+			if (slot.references < max_references)
+				++slot.references;
+		}
+
+		// returns the index position that refers to key (or kVacant)
+		size_t Lookup(const key_t & key, size_t hash) const
+		{
+			for (auto position = hash & kIndexMask; ; position = (position + 1) & kIndexMask)
+			{
+				const auto s = m_index[position];
+				if (s == kVacant)
+					return kVacant;
+				if (m_slots[s].hash == hash && m_equal(m_slots[s].key, key))
+					return position;
+			}
+		}
+
+		// returns the index position that refers to the given slot (which must be occupied)
+		size_t Locate(size_t s) const
+		{
+			auto position = m_slots[s].hash & kIndexMask;
+			while (m_index[position] != s)
+				position = (position + 1) & kIndexMask;
+			return position;
+		}
+
+		// adds the given slot to our index
+		void Index(size_t s)
+		{
+			auto position = m_slots[s].hash & kIndexMask;
+			while (m_index[position] != kVacant)
+				position = (position + 1) & kIndexMask;
+			m_index[position] = s;
+		}
+
+		// removes the given slot (which is referred to by the given index position) from our cache
+		void Vacate(size_t s, size_t position)
+		{
+			// backward shift deletion: pull any following entries of this probe run back into the hole
+			// so that we never need tombstones (which would degrade lookups over time)
+			auto hole = position;
+			for (auto next = (hole + 1) & kIndexMask; m_index[next] != kVacant; next = (next + 1) & kIndexMask)
+			{
+				const auto home = m_slots[m_index[next]].hash & kIndexMask;
+				if (((next - home) & kIndexMask) >= ((next - hole) & kIndexMask))
+				{
+					m_index[hole] = m_index[next];
+					hole = next;
+				}
+			}
+			m_index[hole] = kVacant;
+
+			auto & slot = m_slots[s];
+			slot.key = key_t();
+			slot.value = value_t();
+			slot.occupied = false;
+			slot.references = 0;
+			--m_count;
+		}
+
+		// returns a vacant slot, evicting an entry if necessary
+		size_t Claim()
+		{
+			// while there are vacancies, simply advance to the next one (without aging anyone)
+			if (!IsFull())
+			{
+				while (m_slots[m_hand.get()].occupied)
+					++m_hand;
+				return (m_hand++).get();
+			}
+
+			// otherwise sweep the hand, aging referenced entries, until we find one that has expired
+			for (;;)
+			{
+				auto & slot = m_slots[m_hand.get()];
+				if (!slot.references)
+					break;
+				--slot.references;
+				++m_hand;
+			}
+
+			const auto victim = (m_hand++).get();
+			Vacate(victim, Locate(victim));
+			return victim;
+		}
+
+		size_t								m_count;	// number of occupied slots
+		hand_t								m_hand;		// the next slot to consider for eviction
+		std::array<size_t, index_size()>	m_index;	// open addressed hash index -> slot number (or kVacant)
+		std::array<slot_t, capacity>		m_slots;	// the cached entries
+		hash_t								m_hasher;
+		key_equal_t							m_equal;
+	};
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// ShardedClockCache
+	//
+	//	Thread safe ClockCache, which spreads its entries across a number of independently locked shards
+	//	so that threads hitting different keys seldom contend for the same lock
+	//
+	//	Each shard holds capacity / shards entries, and is evicted independently of the others
+	//	Since a cached entry cannot be safely referenced after its shard is unlocked, Find() returns a copy
+	//////////////////////////////////////////////////////////////////////////
+
+	template <
+		typename key_t,
+		typename value_t,
+		size_t capacity,
+		size_t shards = 16,
+		uint8_t max_references = 1,
+		typename hash_t = std::hash<key_t>,
+		typename key_equal_t = std::equal_to<key_t>
+	>
+	class ShardedClockCache
+	{
+	public:
+
+		static_assert(shards > 0, "ShardedClockCache<> requires at least one shard");
+		static_assert(capacity / shards > 1, "ShardedClockCache<> requires a capacity of at least 2 per shard");
+
+		// types
+		using shard_t = ClockCache<key_t, value_t, capacity / shards, max_references, hash_t, key_equal_t>;
+
+		// size (which is static)
+		static constexpr size_t size() { return shard_t::size() * shards; }
+
+		// attributes
+
+		// returns the number of cached entries (which may be stale by the time the caller looks at it)
+		size_t GetCount() const
+		{
+			size_t count = 0;
+			for (auto & shard : m_shards)
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				count += shard.cache.GetCount();
+			}
+			return count;
+		}
+
+		void Reset()
+		{
+			for (auto & shard : m_shards)
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+				shard.cache.Reset();
+			}
+		}
+
+		// operations
+
+		// returns a copy of the cached value for the given key, if any
+		std::optional<value_t> Find(const key_t & key)
+		{
+			auto & shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			if (const auto p = shard.cache.Find(key))
+				return *p;
+			return std::nullopt;
+		}
+
+		bool Contains(const key_t & key) const
+		{
+			auto & shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			return shard.cache.Contains(key);
+		}
+
+		void Insert(const key_t & key, value_t value)
+		{
+			auto & shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.cache.Insert(key, std::move(value));
+		}
+
+		bool Erase(const key_t & key)
+		{
+			auto & shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			return shard.cache.Erase(key);
+		}
+
+	private:
+
+		// each shard gets its own cache line(s) so that neighboring locks don't false-share
+		struct alignas(64) shard_data
+		{
+			mutable std::mutex	mutex;
+			shard_t				cache;
+		};
+
+		// our shards use the high bits of a fibonacci scrambled hash, leaving the low bits for the shard's own index
+		static size_t GetShardIndex(const key_t & key)
+		{
+			constexpr size_t kGoldenRatio = sizeof(size_t) == 8 ? size_t(0x9E3779B97F4A7C15ull) : size_t(0x9E3779B9u);
+			return ((hash_t()(key) * kGoldenRatio) >> (sizeof(size_t) * 4)) % shards;
+		}
+
+		shard_data & GetShard(const key_t & key) { return m_shards[GetShardIndex(key)]; }
+		const shard_data & GetShard(const key_t & key) const { return m_shards[GetShardIndex(key)]; }
+
+		std::array<shard_data, shards>	m_shards;
+	};
+
+} // namespace
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+//////////////////////////////////////////////////////////////////////////
+// Character classes (English-only, q.v. classic locale)
+//
+//	Each character has a set of classes (bit flags), which for the first 256 characters come from a
+//	constexpr table, and beyond that are simply printable.  Signed characters are classified by their
+//	unsigned value, so the upper half of a char (such as UTF-8 lead and trail bytes) is printable.
+//
+//	See strings.h for the classifiers (is_digit() etc.) and the bulk scanners (find_first_of_class() etc.)
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	// a set of character classes
+	using char_classes = uint8_t;
+
+	namespace char_class {
+		constexpr char_classes control = 0x01;		// 0x00 - 0x1F, 0x7F
+		constexpr char_classes printable = 0x02;	// everything else
+		constexpr char_classes whitespace = 0x04;	// space, \t \n \v \f \r
+		constexpr char_classes lowercase = 0x08;	// a-z
+		constexpr char_classes uppercase = 0x10;	// A-Z
+		constexpr char_classes digit = 0x20;		// 0-9
+		constexpr char_classes hex_digit = 0x40;	// 0-9 a-f A-F
+
+		constexpr char_classes alphabetical = lowercase | uppercase;
+		constexpr char_classes alphanumeric = alphabetical | digit;
+	}
+
+	namespace details {
+
+		constexpr std::array<char_classes, 256> make_char_class_table()
+		{
+			std::array<char_classes, 256> table = {};
+			for (unsigned c = 0; c < 256; ++c)
+			{
+				char_classes classes = c < 0x20 || c == 0x7F ? char_class::control : char_class::printable;
+				if (c == 0x20 || (c >= 0x09 && c <= 0x0D))
+					classes |= char_class::whitespace;
+				if (c >= 'a' && c <= 'z')
+					classes |= char_class::lowercase;
+				if (c >= 'A' && c <= 'Z')
+					classes |= char_class::uppercase;
+				if (c >= '0' && c <= '9')
+					classes |= char_class::digit | char_class::hex_digit;
+				if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+					classes |= char_class::hex_digit;
+				table[c] = classes;
+			}
+			return table;
+		}
+
+		inline constexpr auto kCharClassTable = make_char_class_table();
+
+	}
+
+	// returns the classes of the given character
+	template <typename T>
+	constexpr char_classes get_char_classes(const T & ch)
+	{
+		const auto index = static_cast<std::make_unsigned_t<T>>(ch);
+		return index < details::kCharClassTable.size() ? details::kCharClassTable[index] : char_class::printable;
+	}
+
+	// returns true if the character is in any of the given classes
+	template <typename T>
+	constexpr bool has_char_class(const T & ch, char_classes classes) { return (get_char_classes(ch) & classes) != 0; }
+
+}
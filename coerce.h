@@ -5,7 +5,11 @@
 
 #pragma once
 
+#include <cerrno>			// errno
+#include <cstdint>
 #include <stdexcept>		// std::exception
+#include <string>
+#include <type_traits>
 
 namespace tbx {
 
@@ -93,7 +97,7 @@ namespace tbx {
 			std::conditional_t<sizeof(T) == 4, int32_t,
 			std::conditional_t<sizeof(T) == 8, int64_t,
 			void
-			>>>;
+			>>>>;
 
 		using utype =
 			std::conditional_t<sizeof(T) == 1, uint8_t,
@@ -101,7 +105,7 @@ namespace tbx {
 			std::conditional_t<sizeof(T) == 4, uint32_t,
 			std::conditional_t<sizeof(T) == 8, uint64_t,
 			void
-			>>>;
+			>>>>;
 	};
 
 	// convenience for pointer to scalar conversions
@@ -0,0 +1,274 @@
+// coerce_strings.h
+//
+//	string <-> number conversions for the convert_to<> / As<> / Assign() machinery of coerce.h
+//
+//	usage:
+//		auto port = tbx::As<uint16_t>(field);						// throws if field isn't a uint16_t
+//		if (!tbx::Assign(count, text)) ...							// or returns false
+//		if (tbx::parse_number(column, price)) ...					// without the exceptions (or errno)
+//		auto text = tbx::As<std::string>(3.25);						// "3.25" (the shortest text which round trips)
+//
+//	Strings may be a std::string, a std::string_view or a (null terminated) const char *.  Parsing is
+//	always in the classic locale: leading and trailing whitespace is ignored, as is a leading '+', and
+//	otherwise the whole string must be the number (so "12abc" isn't 12, unlike atoi()).  A bool is
+//	either "true" or "false" (in any case) or a number, which is true if it's non-zero.
+//
+//	Errors are reported by the return value: parse_number() and Assign() return false (leaving the
+//	target unchanged), and As<>() throws std::invalid_argument (not a number) or std::out_of_range (a
+//	number which doesn't fit), as std::stoi() does.
+//
+//	Decimal integers are parsed 8 digits at a time, SIMD within a register (little endian only, as are
+//	all of tbx's targets), and everything else uses std::from_chars() and std::to_chars().
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "coerce.h"
+#include "strings.h"
+
+namespace tbx {
+
+	namespace details {
+
+		namespace numeric {
+
+			constexpr uint64_t kOnes = 0x0101010101010101;
+
+			// returns true if all 8 bytes of word are decimal digits
+			inline bool is_eight_digits(uint64_t word)
+			{
+				// digits are 0x30 - 0x39, so their high nibble is 3, and adding 6 doesn't carry into it
+				return (((word & (kOnes * 0xF0)) | (((word + kOnes * 0x06) & (kOnes * 0xF0)) >> 4)) == kOnes * 0x33);
+			}
+
+			// returns the value of the 8 decimal digits in word (the first in the lowest byte)
+			inline uint32_t parse_eight_digits(uint64_t word)
+			{
+				// combine adjacent digits into 2 digit values, then those into 4 digit values, then those into one 8 digit value
+				word -= kOnes * '0';
+				word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FF;
+				word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFF;
+				return uint32_t((word * 10000 + (word >> 32)) & 0xFFFFFFFF);
+			}
+
+			// parses the decimal digits at first, returning the first non-digit (and sets overflow if they exceeded a uint64_t)
+			inline const char * parse_decimal(const char * first, const char * last, uint64_t & value, bool & overflow)
+			{
+				// leading zeros don't count towards overflow
+				while (first != last && *first == '0')
+					++first;
+				const auto significant = first;
+
+				// 8 at a time, then one at a time (ignoring overflow, which needs 20 significant digits, until the end)
+				value = 0;
+				while (last - first >= 8)
+				{
+					uint64_t word;
+					std::memcpy(&word, first, sizeof(word));
+					if (!is_eight_digits(word))
+						break;
+					value = value * 100000000 + parse_eight_digits(word);
+					first += 8;
+				}
+				for (; first != last && is_digit(*first); ++first)
+					value = value * 10 + unsigned(*first - '0');
+
+				const auto digits = first - significant;
+				overflow = digits > 20;
+				if (digits == 20)
+				{
+					// the first 19 digits fit, so check whether the last one does
+					uint64_t prefix = 0;
+					for (auto p = significant; p != first - 1; ++p)
+						prefix = prefix * 10 + unsigned(*p - '0');
+					const auto digit = unsigned(first[-1] - '0');
+					overflow = prefix > (std::numeric_limits<uint64_t>::max() - digit) / 10;
+				}
+				return first;
+			}
+
+			// parses all of text as an R, returning the error (if any)
+			template <typename R>
+			std::errc parse(std::string_view text, R & value)
+			{
+				if (!text.empty() && (is_whitespace(text.front()) || is_whitespace(text.back())))
+					text = trim(text);
+				// (a '+' may only be followed by the number itself: not another sign, nor a keyword)
+				const bool plus = !text.empty() && text.front() == '+';
+				if (plus)
+					text.remove_prefix(1);
+				if (text.empty() || (plus && (text.front() == '+' || text.front() == '-')))
+					return std::errc::invalid_argument;
+
+				const auto first = text.data();
+				const auto last = first + text.size();
+
+				if constexpr (std::is_same_v<R, bool>)
+				{
+					if (!plus && compare_no_case(text, std::string_view("true")) == 0)
+						return value = true, std::errc();
+					if (!plus && compare_no_case(text, std::string_view("false")) == 0)
+						return value = false, std::errc();
+
+					long double number;
+					const auto error = parse(text, number);
+					if (error == std::errc())
+						value = number != 0;
+					return error;
+				}
+				else if constexpr (std::is_integral_v<R>)
+				{
+					const bool negative = std::is_signed_v<R> && *first == '-';
+					const auto digits = first + negative;
+
+					uint64_t magnitude;
+					bool overflow;
+					const auto end = parse_decimal(digits, last, magnitude, overflow);
+					if (end == digits || end != last)
+						return std::errc::invalid_argument;
+
+					using U = std::make_unsigned_t<R>;
+					const auto limit = uint64_t(std::numeric_limits<R>::max()) + (negative ? 1 : 0);
+					if (overflow || magnitude > limit)
+						return std::errc::result_out_of_range;
+					value = negative ? R(U(0) - U(magnitude)) : R(magnitude);
+					return std::errc();
+				}
+				else
+				{
+					static_assert(std::is_floating_point_v<R>, "parse_number<> requires an arithmetic type");
+					R result;
+					const auto parsed = std::from_chars(first, last, result);
+					if (parsed.ec != std::errc())
+						return parsed.ec;
+					if (parsed.ptr != last)
+						return std::errc::invalid_argument;
+					value = result;
+					return std::errc();
+				}
+			}
+
+			template <typename R>
+			R parse_or_throw(std::string_view text)
+			{
+				R value{};
+				const auto error = parse(text, value);
+				if (error == std::errc())
+					return value;
+				if (error == std::errc::result_out_of_range)
+					throw std::out_of_range("As<>: number out of range");
+				throw std::invalid_argument("As<>: not a number");
+			}
+
+			template <typename T>
+			std::string to_string(T value)
+			{
+				if constexpr (std::is_same_v<T, bool>)
+					return value ? "true" : "false";
+				else
+				{
+					// enough for any integer in base 10, or the shortest round trip text of any floating point value
+					char buffer[64];
+					const auto result = std::to_chars(buffer, std::end(buffer), value);
+					return std::string(buffer, result.ptr);
+				}
+			}
+
+			template <typename R>
+			constexpr bool is_number_v = std::is_arithmetic_v<R> || std::is_enum_v<R>;
+
+		}
+
+	}
+
+	// parses the whole of text as a number, returning false if it isn't one (or it doesn't fit in value, which is then unchanged)
+	template <typename R>
+	bool parse_number(std::string_view text, R & value)
+	{
+		if constexpr (std::is_enum_v<R>)
+		{
+			std::underlying_type_t<R> underlying;
+			if (!parse_number(text, underlying))
+				return false;
+			value = static_cast<R>(underlying);
+			return true;
+		}
+		else
+			return details::numeric::parse(text, value) == std::errc();
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// string -> number
+	//////////////////////////////////////////////////////////////////////////
+
+	template <typename R>
+	struct convert_to<R, std::string_view>
+	{
+		R operator () (std::string_view value)
+		{
+			if constexpr (std::is_enum_v<R>)
+				return static_cast<R>(convert_to<std::underlying_type_t<R>, std::string_view>()(value));
+			else if constexpr (std::is_arithmetic_v<R>)
+				return details::numeric::parse_or_throw<R>(value);
+			else
+				return static_cast<R>(value);
+		}
+	};
+
+	template <typename R> struct convert_to<R, const char *> { R operator () (const char * value) { return convert_to<R, std::string_view>()(StringOrBlank(value)); } };
+	template <typename R> struct convert_to<R, char *> { R operator () (char * value) { return convert_to<R, std::string_view>()(StringOrBlank(value)); } };
+	template <typename R> struct convert_to<R, std::string> { R operator () (const std::string & value) { return convert_to<R, std::string_view>()(value); } };
+
+	// (these resolve the ambiguity with the T -> bool partial specialization of coerce.h)
+	template <> struct convert_to<bool, std::string_view> { bool operator () (std::string_view value) { return details::numeric::parse_or_throw<bool>(value); } };
+	template <> struct convert_to<bool, const char *> { bool operator () (const char * value) { return details::numeric::parse_or_throw<bool>(StringOrBlank(value)); } };
+	template <> struct convert_to<bool, char *> { bool operator () (char * value) { return details::numeric::parse_or_throw<bool>(StringOrBlank(value)); } };
+	template <> struct convert_to<bool, std::string> { bool operator () (const std::string & value) { return details::numeric::parse_or_throw<bool>(value); } };
+
+	//////////////////////////////////////////////////////////////////////////
+	// number -> string
+	//////////////////////////////////////////////////////////////////////////
+
+#define TBX_CONVERT_NUMBER_TO_STRING(type) \
+	template <> struct convert_to<std::string, type> { std::string operator () (type value) { return details::numeric::to_string(value); } };
+
+	TBX_CONVERT_NUMBER_TO_STRING(bool)
+	TBX_CONVERT_NUMBER_TO_STRING(signed char)
+	TBX_CONVERT_NUMBER_TO_STRING(unsigned char)
+	TBX_CONVERT_NUMBER_TO_STRING(short)
+	TBX_CONVERT_NUMBER_TO_STRING(unsigned short)
+	TBX_CONVERT_NUMBER_TO_STRING(int)
+	TBX_CONVERT_NUMBER_TO_STRING(unsigned int)
+	TBX_CONVERT_NUMBER_TO_STRING(long)
+	TBX_CONVERT_NUMBER_TO_STRING(unsigned long)
+	TBX_CONVERT_NUMBER_TO_STRING(long long)
+	TBX_CONVERT_NUMBER_TO_STRING(unsigned long long)
+	TBX_CONVERT_NUMBER_TO_STRING(float)
+	TBX_CONVERT_NUMBER_TO_STRING(double)
+	TBX_CONVERT_NUMBER_TO_STRING(long double)
+
+#undef TBX_CONVERT_NUMBER_TO_STRING
+
+	// (the string -> string conversions, which are otherwise ambiguous)
+	template <> struct convert_to<std::string, std::string_view> { std::string operator () (std::string_view value) { return std::string(value); } };
+	template <> struct convert_to<std::string, const char *> { std::string operator () (const char * value) { return StringOrBlank(value); } };
+	template <> struct convert_to<std::string, char *> { std::string operator () (char * value) { return StringOrBlank(value); } };
+	template <> struct convert_to<std::string, std::string> { std::string operator () (const std::string & value) { return value; } };
+
+	//////////////////////////////////////////////////////////////////////////
+	// Assign(number, string) - which reports failure by its return value, rather than relying upon errno
+	//////////////////////////////////////////////////////////////////////////
+
+	template <typename R> inline auto Assign(R & result, std::string_view source) -> std::enable_if_t<details::numeric::is_number_v<R>, bool> { return parse_number(source, result); }
+	template <typename R> inline auto Assign(R & result, const char * source) -> std::enable_if_t<details::numeric::is_number_v<R>, bool> { return parse_number(StringOrBlank(source), result); }
+	template <typename R> inline auto Assign(R & result, char * source) -> std::enable_if_t<details::numeric::is_number_v<R>, bool> { return parse_number(StringOrBlank(source), result); }
+	template <typename R> inline auto Assign(R & result, const std::string & source) -> std::enable_if_t<details::numeric::is_number_v<R>, bool> { return parse_number(source, result); }
+
+}
@@ -143,13 +143,13 @@ namespace tbx {
 	// isoneof tests whether the initial argument value occurs in the given set of other values
 
 	template <typename T, typename U>
-	bool isoneof(T v, U v1) { return v == v1; }
+	constexpr bool isoneof(T v, U v1) { return v == v1; }
 
 	template <typename T, typename U, typename... Args>
-	bool isoneof(T v, U v1, Args ... others) { return isoneof(v, v1) || isoneof(v, others...); }
+	constexpr bool isoneof(T v, U v1, Args ... others) { return isoneof(v, v1) || isoneof(v, others...); }
 
 	template <typename T, typename U>
-	bool isoneof(T value, std::initializer_list<U> values)
+	constexpr bool isoneof(T value, std::initializer_list<U> values)
 	{
 		for (const auto & e : values)
 			if (value == e)
@@ -158,7 +158,7 @@ namespace tbx {
 	}
 
 	template <typename T, typename U, size_t size>
-	bool isoneof(T value, const U(&arr)[size])
+	constexpr bool isoneof(T value, const U(&arr)[size])
 	{
 		for (size_t i = 0; i < size; ++i)
 			if (value == arr[i])
@@ -1,7 +1,8 @@
 #include "StdAfx.h"
 
 #include "alphanum sort.h"
-#include "SmartChar.h"
+
+#include <type_traits>
 
 #if _AFX // MFC only
 #ifdef _DEBUG
@@ -13,6 +14,75 @@ static char THIS_FILE[] = __FILE__;
 
 namespace Toolbox {
 
+	namespace {
+
+		template <typename ctype>
+		bool is_digit(ctype ch) { return ch >= '0' && ch <= '9'; }
+
+		// the character's unsigned value, with A-Z folded to lowercase unless case sensitive
+		template <typename ctype, bool case_sensitive>
+		auto unit_of(ctype ch)
+		{
+			using unit_t = std::make_unsigned_t<ctype>;
+			return unit_t(!case_sensitive && ch >= 'A' && ch <= 'Z' ? ch | 0x20 : ch);
+		}
+
+		// appends the value as big endian bytes (so that memcmp orders them as numbers)
+		template <typename unit_t>
+		void append_big_endian(std::string & key, unit_t value, size_t bytes = sizeof(unit_t))
+		{
+			while (bytes--)
+				key += char(static_cast<unsigned char>(value >> (8 * bytes)));
+		}
+
+		// the key is a sequence of tokens, each of which starts with a code unit (big endian):
+		//	a character:		its unsigned value (so never zero)
+		//	a run of digits:	zero (so before any character), then the number of significant digits (as the
+		//						number of bytes in that count, and then the count itself), then the significant
+		//						digits, two to a byte
+		// so keys compare as alphanumcmp() does: numbers with more significant digits are larger, and those
+		// with as many are decided by their first differing digit
+		template <typename ctype, bool case_sensitive>
+		std::string alphanumkey(std::basic_string_view<ctype> text)
+		{
+			using unit_t = std::make_unsigned_t<ctype>;
+
+			std::string key;
+			key.reserve(text.size() * sizeof(ctype) + 8);
+
+			const auto end = text.data() + text.size();
+			for (auto p = text.data(); p != end && *p; )
+			{
+				if (!is_digit(*p))
+				{
+					append_big_endian(key, unit_of<ctype, case_sensitive>(*p++));
+					continue;
+				}
+
+				while (p != end && *p == '0')
+					++p;
+				auto digits = p;
+				while (p != end && is_digit(*p))
+					++p;
+
+				const auto count = size_t(p - digits);
+				size_t bytes = 0;
+				while (bytes < sizeof(count) && (count >> (8 * bytes)))
+					++bytes;
+
+				append_big_endian(key, unit_t(0));
+				key += char(bytes);
+				append_big_endian(key, count, bytes);
+				for (; digits + 1 < p; digits += 2)
+					key += char(((digits[0] - '0') << 4) | (digits[1] - '0'));
+				if (digits != p)
+					key += char((digits[0] - '0') << 4);
+			}
+			return key;
+		}
+
+	}
+
 	template <typename ctype, bool case_sensitive>
 	int alphanumcmp(const ctype * pszLeft, const ctype * pszRight)
 	{
@@ -49,9 +119,11 @@ namespace Toolbox {
 
 						// TODO: check if this is a lead-byte, do better comparison, skip trail byte(s)
 
-						// compute the difference of both characters
-						if (const auto diff = (case_sensitive ? left - right : _tolower(left) - _tolower(right)))
-							return diff < 0 ? -1 : 1;
+						// compare both characters (as unsigned values, as strcmp does)
+						const auto l = unit_of<ctype, case_sensitive>(left);
+						const auto r = unit_of<ctype, case_sensitive>(right);
+						if (l != r)
+							return l < r ? -1 : 1;
 
 						// otherwise process the next characters
 						++pszLeft;
@@ -61,27 +133,26 @@ namespace Toolbox {
 			}
 			else // mode==NUMBER
 			{
-				// get the left number
-				unsigned long left = 0;
-				while (*pszLeft && is_digit(*pszLeft))
-				{
-					// TODO: this can overflow
-					left = left * 10 + *pszLeft - '0';
+				// compare the numbers without converting them (so they can be of any length):
+				// ignoring leading zeros, the one with more digits is larger, otherwise the first differing digit decides
+				while (*pszLeft == '0')
 					++pszLeft;
-				}
-
-				// get the right number
-				unsigned long right = 0;
-				while (*pszRight && is_digit(*pszRight))
-				{
-					// TODO: this can overflow
-					right = right * 10 + *pszRight - '0';
+				while (*pszRight == '0')
 					++pszRight;
-				}
 
-				// if the difference is not equal to zero, we have a comparison result
-				if (const auto diff = left - right)
-					return diff < 0 ? -1 : 1;
+				int diff = 0;
+				for (; is_digit(*pszLeft) && is_digit(*pszRight); ++pszLeft, ++pszRight)
+					if (!diff && *pszLeft != *pszRight)
+						diff = *pszLeft < *pszRight ? -1 : 1;
+
+				if (is_digit(*pszLeft))
+					return +1;
+				if (is_digit(*pszRight))
+					return -1;
+
+				// if the numbers differ, we have a comparison result
+				if (diff)
+					return diff;
 
 				// otherwise we process the next substring in STRING mode
 				mode = STRING;
@@ -117,4 +188,24 @@ namespace Toolbox {
 		return alphanumcmp<wchar_t, false>(pszLeft, pszRight);
 	}
 
-}
\ No newline at end of file
+	std::string alphanumkey(std::string_view text)
+	{
+		return alphanumkey<char, true>(text);
+	}
+
+	std::string alphanumkey(std::wstring_view text)
+	{
+		return alphanumkey<wchar_t, true>(text);
+	}
+
+	std::string alphanumkeyi(std::string_view text)
+	{
+		return alphanumkey<char, false>(text);
+	}
+
+	std::string alphanumkeyi(std::wstring_view text)
+	{
+		return alphanumkey<wchar_t, false>(text);
+	}
+
+}
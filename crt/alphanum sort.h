@@ -5,13 +5,26 @@
 
 #pragma once
 
+#include <string>
+#include <string_view>
+
 namespace Toolbox {
 
 
 	// returns the usual strcmp/strcmpi results of -1, 0, or 1
+	// runs of digits compare as numbers (of any length), and come before any other character
+	// other characters compare as unsigned values (the i versions fold A-Z to lowercase first)
 	int alphanumcmp(const char * pszLeft, const char * pszRight);
 	int alphanumcmp(const wchar_t * pszLeft, const wchar_t * pszRight);
 	int alphanumcmpi(const char * pszLeft, const char * pszRight);
 	int alphanumcmpi(const wchar_t * pszLeft, const wchar_t * pszRight);
 
-}
\ No newline at end of file
+	// returns a binary sort key for the string (up to any null), which orders as alphanumcmp() / alphanumcmpi() do
+	// when keys are compared as bytes (memcmp, and then the shorter first - as std::string::compare() does)
+	// so a large sort can make each key once, and then use plain byte comparisons (or a radix sort)
+	std::string alphanumkey(std::string_view text);
+	std::string alphanumkey(std::wstring_view text);
+	std::string alphanumkeyi(std::string_view text);
+	std::string alphanumkeyi(std::wstring_view text);
+
+}
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "deferred_log.h"
+
+#include <charconv>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+namespace tbx {
+
+	namespace deferred_log {
+
+		namespace {
+
+			// registered formats (a deque, so that they never move once registered)
+			struct registry
+			{
+				std::mutex			mutex;
+				std::deque<format>	formats;
+
+				static registry & get()
+				{
+					static registry instance;
+					return instance;
+				}
+			};
+
+			// reads a fixed size value from the record, returns false if there isn't one there
+			template <typename T>
+			bool read(const char *& p, const char * end, T & value)
+			{
+				if (static_cast<size_t>(end - p) < sizeof(value))
+					return false;
+				std::memcpy(&value, p, sizeof(value));
+				p += sizeof(value);
+				return true;
+			}
+
+			template <typename T>
+			void append_number(std::string & out, T value)
+			{
+				char buffer[32];
+				const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+				out.append(buffer, result.ptr);
+			}
+
+			// appends the argument with the given signature code, returns false if the record is malformed
+			bool append_argument(std::string & out, char code, const char *& p, const char * end)
+			{
+				switch (code)
+				{
+				case 'b':
+				{
+					uint8_t value;
+					if (!read(p, end, value))
+						return false;
+					out += value ? "true" : "false";
+					return true;
+				}
+				case 'c':
+				{
+					char value;
+					if (!read(p, end, value))
+						return false;
+					out += value;
+					return true;
+				}
+				case 'i':
+				{
+					int64_t value;
+					if (!read(p, end, value))
+						return false;
+					append_number(out, value);
+					return true;
+				}
+				case 'u':
+				{
+					uint64_t value;
+					if (!read(p, end, value))
+						return false;
+					append_number(out, value);
+					return true;
+				}
+				case 'f':
+				{
+					double value;
+					if (!read(p, end, value))
+						return false;
+					append_number(out, value);
+					return true;
+				}
+				case 'p':
+				{
+					uint64_t value;
+					if (!read(p, end, value))
+						return false;
+					char buffer[32];
+					const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, 16);
+					out += "0x";
+					out.append(buffer, result.ptr);
+					return true;
+				}
+				case 's':
+				{
+					uint32_t length;
+					if (!read(p, end, length) || static_cast<size_t>(end - p) < length)
+						return false;
+					out.append(p, length);
+					p += length;
+					return true;
+				}
+				default:
+					return false;
+				}
+			}
+
+		}
+
+		uint32_t register_format(const char * text, const char * signature)
+		{
+			auto & r = registry::get();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.formats.push_back({ text, signature });
+			return static_cast<uint32_t>(r.formats.size() - 1);
+		}
+
+		uint32_t get_format_count()
+		{
+			auto & r = registry::get();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			return static_cast<uint32_t>(r.formats.size());
+		}
+
+		format get_format(uint32_t id)
+		{
+			auto & r = registry::get();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			if (id >= r.formats.size())
+				throw std::out_of_range("deferred_log::get_format() : unknown format ID");
+			return r.formats[id];
+		}
+
+		void render(std::string & out, const char * record, size_t length)
+		{
+			uint32_t id;
+			const auto end = record + length;
+			if (!read(record, end, id))
+				return;
+			render(out, get_format(id), record, end - record);
+		}
+
+		void render(std::string & out, const format & f, const char * args, size_t length)
+		{
+			const auto end = args + length;
+			auto code = f.signature;
+			for (auto text = f.text; *text; ++text)
+			{
+				if ((text[0] == '{' && text[1] == '{') || (text[0] == '}' && text[1] == '}'))
+				{
+					out += *text++;
+				}
+				else if (text[0] == '{' && text[1] == '}' && *code)
+				{
+					if (!append_argument(out, *code++, args, end))
+						out += "{?}";
+					++text;
+				}
+				else
+					out += *text;
+			}
+		}
+
+	}
+
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "log_lanes.h"
+
+//////////////////////////////////////////////////////////////////////////
+// deferred_log
+//
+//	Logging which defers all of its formatting to the log lanes' flusher thread
+//
+//	usage:
+//		dxout("processed {} records in {}s from {}\n", count, seconds, filename);
+//		TBX_DEFERRED_LOG(my_stream, "x = {}\n", x);
+//
+//	Each call site registers its format string once (receiving a small format ID), and thereafter each call
+//	merely copies that ID and the raw bytes of its arguments into the calling thread's log lane.  The flusher
+//	later renders the record as text (replacing each {} with the next argument) and writes it out, with the
+//	same thread safety, ordering and line atomicity as mutex_stream (see log_lanes.h).
+//
+//	Arguments may be bools, characters, integers, floating point values, pointers, and strings (const char *,
+//	std::string, std::string_view).  Strings are copied, since they may be long gone by the time they're
+//	formatted, and are truncated if need be to keep the record within kMaxRecordSize.
+//	Use {{ and }} for literal braces.
+//
+//	Records are self-describing given their format (its text and argument signature), so they may also be
+//	decoded elsewhere, such as by an offline tool: see get_format() and render()
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace deferred_log {
+
+		// the largest record (format ID + arguments) that post() will create
+		constexpr size_t kMaxRecordSize = 1024;
+
+		// a registered format
+		struct format
+		{
+			const char *	text;		// the format string
+			const char *	signature;	// one code per argument (see details::argument<>)
+		};
+
+		// registers a format, returning its ID (post() does this once per call site)
+		uint32_t register_format(const char * text, const char * signature);
+
+		// returns the number of registered formats (their IDs are 0 .. count - 1)
+		uint32_t get_format_count();
+
+		// returns the format with the given ID
+		format get_format(uint32_t id);
+
+		// renders a record (as posted by post()) as text, appending it to out
+		void render(std::string & out, const char * record, size_t length);
+
+		// renders a record's arguments (the bytes which follow its format ID) using the given format, appending it to out
+		// this doesn't require the format registry, so it may also be used to decode records offline
+		void render(std::string & out, const format & f, const char * args, size_t length);
+
+		namespace details {
+
+			// argument<T> supplies the signature code for a type, and how to encode it
+			//	fixed_size is how many bytes it always takes up in a record
+			//	strings additionally take up to budget bytes for their characters (and deduct what they use)
+			template <typename T, typename = void>
+			struct argument;
+
+			template <typename T, typename U>
+			size_t encode_as(char * p, const T & value)
+			{
+				const U u = static_cast<U>(value);
+				std::memcpy(p, &u, sizeof(u));
+				return sizeof(u);
+			}
+
+			template <>
+			struct argument<bool>
+			{
+				static constexpr char code = 'b';
+				static constexpr size_t fixed_size = 1;
+				static size_t encode(char * p, size_t &, bool value) { return encode_as<bool, uint8_t>(p, value); }
+			};
+
+			template <>
+			struct argument<char>
+			{
+				static constexpr char code = 'c';
+				static constexpr size_t fixed_size = 1;
+				static size_t encode(char * p, size_t &, char value) { return encode_as<char, char>(p, value); }
+			};
+
+			template <typename T>
+			struct argument<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && !std::is_same_v<T, char>>>
+			{
+				static constexpr char code = 'i';
+				static constexpr size_t fixed_size = 8;
+				static size_t encode(char * p, size_t &, T value) { return encode_as<T, int64_t>(p, value); }
+			};
+
+			template <typename T>
+			struct argument<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>>>
+			{
+				static constexpr char code = 'u';
+				static constexpr size_t fixed_size = 8;
+				static size_t encode(char * p, size_t &, T value) { return encode_as<T, uint64_t>(p, value); }
+			};
+
+			template <typename T>
+			struct argument<T, std::enable_if_t<std::is_enum_v<T>>> : argument<std::underlying_type_t<T>>
+			{
+				static size_t encode(char * p, size_t & budget, T value) { return argument<std::underlying_type_t<T>>::encode(p, budget, static_cast<std::underlying_type_t<T>>(value)); }
+			};
+
+			template <typename T>
+			struct argument<T, std::enable_if_t<std::is_floating_point_v<T>>>
+			{
+				static constexpr char code = 'f';
+				static constexpr size_t fixed_size = 8;
+				static size_t encode(char * p, size_t &, T value) { return encode_as<T, double>(p, value); }
+			};
+
+			template <>
+			struct argument<std::string_view>
+			{
+				static constexpr char code = 's';
+				static constexpr size_t fixed_size = 4;
+				static size_t encode(char * p, size_t & budget, std::string_view value)
+				{
+					const auto length = static_cast<uint32_t>(value.size() < budget ? value.size() : budget);
+					budget -= length;
+					std::memcpy(p, &length, sizeof(length));
+					std::memcpy(p + sizeof(length), value.data(), length);
+					return sizeof(length) + length;
+				}
+			};
+
+			template <>
+			struct argument<std::string> : argument<std::string_view> {};
+
+			template <>
+			struct argument<const char *> : argument<std::string_view>
+			{
+				static size_t encode(char * p, size_t & budget, const char * value) { return argument<std::string_view>::encode(p, budget, value ? value : ""); }
+			};
+
+			template <>
+			struct argument<char *> : argument<const char *> {};
+
+			// other pointers are recorded by address
+			template <typename T>
+			struct argument<T *, std::enable_if_t<!std::is_same_v<std::remove_cv_t<T>, char>>>
+			{
+				static constexpr char code = 'p';
+				static constexpr size_t fixed_size = 8;
+				static size_t encode(char * p, size_t &, const T * value) { return encode_as<uintptr_t, uint64_t>(p, reinterpret_cast<uintptr_t>(value)); }
+			};
+
+			// string literals and character arrays decay to pointers
+			template <typename T>
+			using argument_t = argument<std::decay_t<T>>;
+
+			template <typename ... Args>
+			struct signature
+			{
+				static constexpr char value[] = { argument_t<Args>::code..., 0 };
+			};
+
+			// counts the {} placeholders in a format (ignoring {{ and }})
+			constexpr size_t count_placeholders(const char * text)
+			{
+				size_t count = 0;
+				for (; *text; ++text)
+				{
+					if ((text[0] == '{' && text[1] == '{') || (text[0] == '}' && text[1] == '}'))
+						++text;
+					else if (text[0] == '{' && text[1] == '}')
+						++count, ++text;
+				}
+				return count;
+			}
+
+		}
+
+		// posts a deferred record to os
+		// format_source is a function object which returns the format string, whose type must be unique to the call site (see TBX_DEFERRED_LOG)
+		template <typename format_source_t, typename ... Args>
+		void post(std::ostream & os, format_source_t format_source, const Args & ... args)
+		{
+			static_assert(details::count_placeholders(format_source()) == sizeof...(Args), "the number of {} placeholders must match the number of arguments");
+
+			constexpr size_t fixed_size = sizeof(uint32_t) + (size_t(0) + ... + details::argument_t<Args>::fixed_size);
+			static_assert(fixed_size <= kMaxRecordSize, "too many arguments for a deferred log record");
+
+			// registered the first time through (for this call site)
+			static const uint32_t id = register_format(format_source(), details::signature<Args...>::value);
+
+			char record[kMaxRecordSize];
+			std::memcpy(record, &id, sizeof(id));
+			size_t length = sizeof(id);
+			[[maybe_unused]] size_t budget = kMaxRecordSize - fixed_size;		// (unused when there are no arguments)
+			((length += details::argument_t<Args>::encode(record + length, budget, args)), ...);
+
+			log_lanes::post_deferred(os, &render, record, length);
+		}
+
+	}
+
+}
+
+// usage: TBX_DEFERRED_LOG(stream, "format with {} placeholders\n", args...)
+// the lambda gives each call site its own instantiation of post() (and hence its own format ID), and keeps the format a compile time constant
+#define TBX_DEFERRED_LOG(os, format, ...) tbx::deferred_log::post((os), [] { return format; }, ##__VA_ARGS__)
+
+// deferred equivalents of mxout and mxerr
+#define dxout(format, ...) TBX_DEFERRED_LOG(std::cout, format, ##__VA_ARGS__)
+#define dxerr(format, ...) TBX_DEFERRED_LOG(std::cerr, format, ##__VA_ARGS__)
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// fixed_string<T, N>
+//
+//	A string of up to N characters which lives entirely inline (on the stack, or in its owner), and knows
+//	its own length - so appending is O(appended), rather than rescanning the buffer as concatenate() must
+//
+//	usage:
+//		tbx::fixed_string<char, 64> key("section.");
+//		key += name;
+//		key += '.';
+//		key.append(field, field_length);
+//		lookup(key.view());								// or key.c_str(), or anything that takes a string_view
+//
+//	It's always null terminated, so c_str() is free, and it's trivially copyable (copying it copies the
+//	length and the whole buffer - so keep N small).  Appends which don't fit are handed to the overflow_policy:
+//	throw_range_error (the default) throws without changing the string, and truncate keeps as much as fits.
+//
+//	It supports GetLength(), get_string(), IsEmpty(), the in-place trims, make_string_back_inserter() and
+//	the comparisons of strings.h, and converts implicitly to a string_view for everything else.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <typename T, size_t N, typename overflow_policy = overflow_policy::throw_range_error>
+	class fixed_string
+	{
+	public:
+		using value_type = T;
+		using traits_type = std::char_traits<T>;
+		using view_type = std::basic_string_view<T>;
+		using size_type = size_t;
+		using iterator = T *;
+		using const_iterator = const T *;
+
+		fixed_string() { m_buffer[0] = 0; }
+		fixed_string(const T * psz) : fixed_string() { append(psz); }
+		fixed_string(const T * text, size_t length) : fixed_string() { append(text, length); }
+		fixed_string(view_type text) : fixed_string() { append(text); }
+
+		// anything else that's viewable as a string (std::basic_string, another fixed_string...)
+		template <
+			typename string_t,
+			typename std::enable_if_t<!std::is_same_v<string_t, fixed_string> && !std::is_convertible_v<const string_t &, const T *> && std::is_convertible_v<const string_t &, view_type>, int> = 0
+		>
+		fixed_string(const string_t & text) : fixed_string(view_type(text)) {}
+
+		fixed_string & operator = (const T * psz) { clear(); return append(psz); }
+		fixed_string & operator = (view_type text) { clear(); return append(text); }
+
+		fixed_string & assign(const T * text, size_t length) { clear(); return append(text, length); }
+
+		// capacity
+		static constexpr size_t capacity() { return N; }
+		size_t size() const { return m_length; }
+		size_t length() const { return m_length; }
+		bool empty() const { return m_length == 0; }
+		bool full() const { return m_length == N; }
+
+		// access
+		T * data() { return m_buffer; }
+		const T * data() const { return m_buffer; }
+		const T * c_str() const { return m_buffer; }
+		view_type view() const { return view_type(m_buffer, m_length); }
+		operator view_type () const { return view(); }
+
+		T & operator [] (size_t index) { return m_buffer[index]; }
+		const T & operator [] (size_t index) const { return m_buffer[index]; }
+		T & front() { return m_buffer[0]; }
+		const T & front() const { return m_buffer[0]; }
+		T & back() { return m_buffer[m_length - 1]; }
+		const T & back() const { return m_buffer[m_length - 1]; }
+
+		iterator begin() { return m_buffer; }
+		iterator end() { return m_buffer + m_length; }
+		const_iterator begin() const { return m_buffer; }
+		const_iterator end() const { return m_buffer + m_length; }
+
+		// modification
+		void clear() { truncate(0); }
+
+		void pop_back() { truncate(m_length - 1); }
+
+		// shortens the string to the given length (if it's longer than that)
+		void truncate(size_t length)
+		{
+			if (length < m_length)
+			{
+				m_length = length;
+				m_buffer[m_length] = 0;
+			}
+		}
+
+		iterator erase(const_iterator first, const_iterator last)
+		{
+			const auto offset = size_t(first - m_buffer);
+			const auto tail = size_t(end() - last);
+			traits_type::move(m_buffer + offset, last, tail);
+			m_length = offset + tail;
+			m_buffer[m_length] = 0;
+			return m_buffer + offset;
+		}
+
+		void push_back(T c)
+		{
+			if (full())
+				return overflow_policy::handle_overflow(__FUNCTION__);
+			m_buffer[m_length++] = c;
+			m_buffer[m_length] = 0;
+		}
+
+		fixed_string & append(const T * text, size_t length)
+		{
+			if (length > N - m_length)
+			{
+				overflow_policy::handle_overflow(__FUNCTION__);
+				length = N - m_length;
+			}
+			traits_type::copy(m_buffer + m_length, text, length);
+			m_length += length;
+			m_buffer[m_length] = 0;
+			return *this;
+		}
+
+		fixed_string & append(view_type text) { return append(text.data(), text.size()); }
+		fixed_string & append(const T * psz) { return psz ? append(psz, GetLength(psz)) : *this; }
+		fixed_string & append(size_t count, T c)
+		{
+			if (count > N - m_length)
+			{
+				overflow_policy::handle_overflow(__FUNCTION__);
+				count = N - m_length;
+			}
+			traits_type::assign(m_buffer + m_length, count, c);
+			m_length += count;
+			m_buffer[m_length] = 0;
+			return *this;
+		}
+
+		fixed_string & operator += (T c) { push_back(c); return *this; }
+		fixed_string & operator += (const T * psz) { return append(psz); }
+		fixed_string & operator += (view_type text) { return append(text); }
+
+		// comparison (q.v. compare() and compare_no_case())
+		strcmpcode compare(view_type text) const { return tbx::compare(view(), text); }
+		strcmpcode compare_no_case(view_type text) const { return tbx::compare_no_case(view(), text); }
+
+		// searching (q.v. find() and reverse_find()), returns nullptr if not found
+		const T * find(T chr) const { return tbx::find(view(), chr); }
+		const T * find(view_type text) const { return tbx::find(view(), text); }
+		const T * reverse_find(T chr) const { return tbx::reverse_find(view(), chr); }
+		const T * reverse_find(view_type text) const { return tbx::reverse_find(view(), text); }
+
+	private:
+		size_t	m_length = 0;
+		T		m_buffer[N + 1];
+	};
+
+	namespace details {
+
+		template <typename T>
+		struct is_fixed_string : std::false_type {};
+
+		template <typename T, size_t N, typename overflow_policy>
+		struct is_fixed_string<fixed_string<T, N, overflow_policy>> : std::true_type {};
+
+		// anything viewable as a basic_string_view<T> that isn't itself a fixed_string
+		template <typename T, typename string_t>
+		using enable_if_viewable = std::enable_if_t<!is_fixed_string<string_t>::value && std::is_convertible_v<const string_t &, std::basic_string_view<T>>, bool>;
+
+	}
+
+	// comparison operators (lexicographical, as compare())
+	template <typename T, size_t N, typename P, size_t M, typename Q>
+	bool operator == (const fixed_string<T, N, P> & lhs, const fixed_string<T, M, Q> & rhs) { return lhs.view() == rhs.view(); }
+	template <typename T, size_t N, typename P, size_t M, typename Q>
+	bool operator != (const fixed_string<T, N, P> & lhs, const fixed_string<T, M, Q> & rhs) { return lhs.view() != rhs.view(); }
+	template <typename T, size_t N, typename P, size_t M, typename Q>
+	bool operator < (const fixed_string<T, N, P> & lhs, const fixed_string<T, M, Q> & rhs) { return lhs.view() < rhs.view(); }
+
+	template <typename T, size_t N, typename P, typename string_t>
+	auto operator == (const fixed_string<T, N, P> & lhs, const string_t & rhs) -> details::enable_if_viewable<T, string_t> { return lhs.view() == std::basic_string_view<T>(rhs); }
+	template <typename T, size_t N, typename P, typename string_t>
+	auto operator != (const fixed_string<T, N, P> & lhs, const string_t & rhs) -> details::enable_if_viewable<T, string_t> { return lhs.view() != std::basic_string_view<T>(rhs); }
+	template <typename T, size_t N, typename P, typename string_t>
+	auto operator < (const fixed_string<T, N, P> & lhs, const string_t & rhs) -> details::enable_if_viewable<T, string_t> { return lhs.view() < std::basic_string_view<T>(rhs); }
+
+	template <typename string_t, typename T, size_t N, typename P>
+	auto operator == (const string_t & lhs, const fixed_string<T, N, P> & rhs) -> details::enable_if_viewable<T, string_t> { return std::basic_string_view<T>(lhs) == rhs.view(); }
+	template <typename string_t, typename T, size_t N, typename P>
+	auto operator != (const string_t & lhs, const fixed_string<T, N, P> & rhs) -> details::enable_if_viewable<T, string_t> { return std::basic_string_view<T>(lhs) != rhs.view(); }
+	template <typename string_t, typename T, size_t N, typename P>
+	auto operator < (const string_t & lhs, const fixed_string<T, N, P> & rhs) -> details::enable_if_viewable<T, string_t> { return std::basic_string_view<T>(lhs) < rhs.view(); }
+
+	// the strings.h operations, knowing the length (so without rescanning the buffer)
+
+	// copy source to dest, returns dest
+	template <typename T, size_t N, typename P>
+	auto & copy(fixed_string<T, N, P> & dest, const T * source) { dest.clear(); return dest.append(source); }
+
+	// partial copy
+	template <typename T, size_t N, typename P>
+	auto & copy(fixed_string<T, N, P> & dest, const T * source, size_t length) { dest.clear(); return dest.append(source, length); }
+
+	// concatenation
+	template <typename T, size_t N, typename P>
+	auto & concatenate(fixed_string<T, N, P> & dest, const T * source) { return dest.append(source); }
+
+	// partial concatenation
+	template <typename T, size_t N, typename P>
+	auto & concatenate(fixed_string<T, N, P> & dest, const T * source, size_t length) { return dest.append(source, length); }
+
+	// English-only case conversion (in place)
+	template <typename T, size_t N, typename P>
+	auto & make_uppercase(fixed_string<T, N, P> & dest) { make_uppercase(dest.data(), dest.size()); return dest; }
+
+	template <typename T, size_t N, typename P>
+	auto & make_lowercase(fixed_string<T, N, P> & dest) { make_lowercase(dest.data(), dest.size()); return dest; }
+
+	static_assert(std::is_trivially_copyable_v<fixed_string<char, 15>>, "fixed_string<> must be trivially copyable");
+
+}
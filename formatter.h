@@ -0,0 +1,456 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+//////////////////////////////////////////////////////////////////////////
+// formatter
+//
+//	Type safe string formatting, with the format parsed and checked at compile time
+//
+//	usage:
+//		auto s = tbx::format(TBX_FORMAT("{} of {} done ({:.1f}%)"), done, total, percent);
+//		tbx::format_append(s, TBX_FORMAT(" [{:08x}]"), flags);
+//		char buffer[64];
+//		auto view = tbx::format_to(buffer, TBX_FORMAT("{:>10}|"), name);
+//		tbx::format_to(make_string_back_inserter(target), TBX_FORMAT("{}"), value);
+//
+//	Each {} is replaced by the next argument, and {{ and }} are literal braces.  A field may have a spec,
+//	{:[<|>][0][width][.precision][type]}, where:
+//		< or > aligns the field left or right (the default) within width
+//		0 pads numbers with zeros after their sign (rather than with spaces)
+//		precision is the digits after the point (e, f), the significant digits (g), or the most characters of a string
+//		type is d x X o b for integers, e f g for floating point (default: the shortest which round trips)
+//
+//	Arguments may be bools, characters, integers, enums, floating point values, strings (const char *,
+//	std::string, std::string_view) and pointers.  Numbers are written using std::to_chars (so never
+//	depend on the locale).
+//
+//	The format is broken into its pieces at compile time (by way of the TBX_FORMAT lambda, which keeps it a
+//	constant expression), and a malformed format or the wrong number of arguments fails to compile.
+//	Formatting into a string sizes it once for the worst case, and then writes directly into it.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace formatting {
+
+			// a replacement field's spec
+			struct spec
+			{
+				char		align = '>';
+				char		fill = ' ';
+				uint16_t	width = 0;
+				int16_t		precision = -1;
+				char		type = 0;
+			};
+
+			// a piece of a format: either literal text, or a replacement field
+			struct piece
+			{
+				uint32_t	offset = 0;			// the literal text's position in the format
+				uint32_t	length = 0;			// and its length
+				int32_t		argument = -1;		// or the index of the argument to format here
+				spec		format;
+			};
+
+			constexpr uint16_t kMaxWidth = 1024;
+			constexpr int16_t kMaxPrecision = 100;
+
+			constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+			// breaks a format into its pieces (storing them if pieces isn't null)
+			// returns the number of pieces, or -1 if the format is malformed, and the number of replacement fields in arguments
+			constexpr int parse(const char * text, piece * pieces, size_t & arguments)
+			{
+				int count = 0;
+				arguments = 0;
+				size_t literal = 0;
+				size_t i = 0;
+				while (text[i])
+				{
+					const auto c = text[i];
+					if ((c == '{' && text[i + 1] == '{') || (c == '}' && text[i + 1] == '}'))
+					{
+						// the literal text runs up to and including the first of the pair
+						if (pieces)
+							pieces[count] = { uint32_t(literal), uint32_t(i + 1 - literal), -1, {} };
+						++count;
+						i += 2;
+						literal = i;
+						continue;
+					}
+					if (c == '}')
+						return -1;
+					if (c != '{')
+					{
+						++i;
+						continue;
+					}
+
+					if (i > literal)
+					{
+						if (pieces)
+							pieces[count] = { uint32_t(literal), uint32_t(i - literal), -1, {} };
+						++count;
+					}
+
+					spec s;
+					if (text[++i] == ':')
+					{
+						++i;
+						if (text[i] == '<' || text[i] == '>')
+							s.align = text[i++];
+						if (text[i] == '0')
+						{
+							s.fill = '0';
+							++i;
+						}
+						unsigned width = 0;
+						while (is_digit(text[i]))
+						{
+							width = width * 10 + (text[i++] - '0');
+							if (width > kMaxWidth)
+								return -1;
+						}
+						s.width = uint16_t(width);
+						if (text[i] == '.')
+						{
+							if (!is_digit(text[++i]))
+								return -1;
+							int precision = 0;
+							while (is_digit(text[i]))
+							{
+								precision = precision * 10 + (text[i++] - '0');
+								if (precision > kMaxPrecision)
+									return -1;
+							}
+							s.precision = int16_t(precision);
+						}
+						for (auto type : { 'd', 'x', 'X', 'o', 'b', 'e', 'f', 'g' })
+							if (text[i] == type)
+								s.type = text[i++];
+					}
+					if (text[i] != '}')
+						return -1;
+
+					if (pieces)
+						pieces[count] = { 0, 0, int32_t(arguments), s };
+					++count;
+					++arguments;
+					literal = ++i;
+				}
+				if (i > literal)
+				{
+					if (pieces)
+						pieces[count] = { uint32_t(literal), uint32_t(i - literal), -1, {} };
+					++count;
+				}
+				return count;
+			}
+
+			template <typename format_source_t>
+			constexpr int count_pieces(format_source_t format_source)
+			{
+				size_t arguments = 0;
+				return parse(format_source(), nullptr, arguments);
+			}
+
+			template <typename format_source_t>
+			constexpr size_t count_arguments(format_source_t format_source)
+			{
+				size_t arguments = 0;
+				parse(format_source(), nullptr, arguments);
+				return arguments;
+			}
+
+			template <size_t count, typename format_source_t>
+			constexpr std::array<piece, count> get_pieces(format_source_t format_source)
+			{
+				std::array<piece, count> pieces = {};
+				size_t arguments = 0;
+				parse(format_source(), pieces.data(), arguments);
+				return pieces;
+			}
+
+			// an argument, with its type erased
+			struct argument
+			{
+				enum class kind : uint8_t { boolean, character, signed_integer, unsigned_integer, floating_point, string, pointer };
+
+				kind	type;
+				union
+				{
+					bool		b;
+					char		c;
+					int64_t		i;
+					uint64_t	u;
+					double		f;
+					const void *	p;
+					struct
+					{
+						const char *	text;
+						size_t			length;
+					}			s;
+				};
+			};
+
+			inline argument make_argument(bool value) { argument a{ argument::kind::boolean, {} }; a.b = value; return a; }
+			inline argument make_argument(char value) { argument a{ argument::kind::character, {} }; a.c = value; return a; }
+			inline argument make_argument(double value) { argument a{ argument::kind::floating_point, {} }; a.f = value; return a; }
+			inline argument make_argument(std::string_view value) { argument a{ argument::kind::string, {} }; a.s = { value.data(), value.size() }; return a; }
+			inline argument make_argument(const std::string & value) { return make_argument(std::string_view(value)); }
+			inline argument make_argument(const char * value) { return make_argument(std::string_view(value ? value : "")); }
+			inline argument make_argument(char * value) { return make_argument(static_cast<const char *>(value)); }
+
+			template <typename T, typename std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && !std::is_same_v<T, char>, int> = 0>
+			argument make_argument(T value) { argument a{ argument::kind::signed_integer, {} }; a.i = value; return a; }
+
+			template <typename T, typename std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>, int> = 0>
+			argument make_argument(T value) { argument a{ argument::kind::unsigned_integer, {} }; a.u = value; return a; }
+
+			template <typename T, typename std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+			argument make_argument(T value) { return make_argument(static_cast<double>(value)); }
+
+			template <typename T, typename std::enable_if_t<std::is_enum_v<T>, int> = 0>
+			argument make_argument(T value) { return make_argument(static_cast<std::underlying_type_t<T>>(value)); }
+
+			template <typename T, typename std::enable_if_t<!std::is_same_v<std::remove_cv_t<T>, char>, int> = 0>
+			argument make_argument(T * value) { argument a{ argument::kind::pointer, {} }; a.p = value; return a; }
+
+			// the most characters an argument can take up
+			inline size_t get_bound(const spec & s, const argument & a)
+			{
+				size_t bound = 0;
+				switch (a.type)
+				{
+				case argument::kind::boolean: bound = 5; break;
+				case argument::kind::character: bound = 1; break;
+				case argument::kind::signed_integer:
+				case argument::kind::unsigned_integer: bound = 65; break;
+				case argument::kind::pointer: bound = 18; break;
+				case argument::kind::string: bound = s.precision < 0 ? a.s.length : std::min<size_t>(a.s.length, s.precision); break;
+				case argument::kind::floating_point:
+					// fixed notation writes all of the integer digits (up to 309 for a double)
+					bound = 32 + (s.precision < 0 ? 0 : s.precision);
+					if ((s.type == 'f' || s.type == 0) && std::isfinite(a.f) && std::fabs(a.f) >= 1e16)
+						bound += 310;
+
+					// and without a precision, all of the leading zeros of a tiny value ("-0." then up to 323 zeros and 17 digits)
+					if (s.type == 'f' && s.precision < 0)
+						bound = std::max<size_t>(bound, 350);
+					break;
+				}
+				return std::max<size_t>(bound, s.width);
+			}
+
+			// writes straight into storage which is known to be large enough
+			struct unchecked_sink
+			{
+				char * p;
+
+				void append(const char * text, size_t length) { std::memcpy(p, text, length); p += length; }
+				void append(size_t count, char c) { std::memset(p, c, count); p += count; }
+			};
+
+			// writes into a fixed buffer, throwing if it overflows
+			struct bounded_sink
+			{
+				char * p;
+				char * end;
+
+				void reserve(size_t length)
+				{
+					if (length > size_t(end - p))
+						throw std::range_error("tbx::format_to() - buffer full!");
+				}
+				void append(const char * text, size_t length) { reserve(length); std::memcpy(p, text, length); p += length; }
+				void append(size_t count, char c) { reserve(count); std::memset(p, c, count); p += count; }
+			};
+
+			// writes to an output iterator
+			template <typename output_iterator_t>
+			struct iterator_sink
+			{
+				output_iterator_t out;
+
+				void append(const char * text, size_t length) { while (length--) *out++ = *text++; }
+				void append(size_t count, char c) { while (count--) *out++ = c; }
+			};
+
+			// writes text (after its sign, if any) padded out to the field's width
+			template <typename sink_t>
+			void write_padded(sink_t & sink, const spec & s, const char * text, size_t length, bool numeric)
+			{
+				const auto padding = s.width > length ? s.width - length : 0;
+				if (!padding)
+					return sink.append(text, length);
+				if (s.align == '<')
+				{
+					sink.append(text, length);
+					return sink.append(padding, ' ');
+				}
+				if (numeric && s.fill == '0')
+				{
+					if (*text == '-')
+					{
+						sink.append(text++, 1);
+						--length;
+					}
+					sink.append(padding, '0');
+					return sink.append(text, length);
+				}
+				sink.append(padding, ' ');
+				sink.append(text, length);
+			}
+
+			template <typename sink_t>
+			void write(sink_t & sink, const spec & s, const argument & a)
+			{
+				char buffer[512];
+				auto end = buffer;
+				switch (a.type)
+				{
+				case argument::kind::boolean:
+					return write_padded(sink, s, a.b ? "true" : "false", a.b ? 4 : 5, false);
+
+				case argument::kind::character:
+					return write_padded(sink, s, &a.c, 1, false);
+
+				case argument::kind::string:
+					return write_padded(sink, s, a.s.text, s.precision < 0 ? a.s.length : std::min<size_t>(a.s.length, s.precision), false);
+
+				case argument::kind::signed_integer:
+				case argument::kind::unsigned_integer:
+				{
+					const int base = s.type == 'x' || s.type == 'X' ? 16 : s.type == 'o' ? 8 : s.type == 'b' ? 2 : 10;
+					end = a.type == argument::kind::signed_integer ?
+						std::to_chars(buffer, std::end(buffer), a.i, base).ptr :
+						std::to_chars(buffer, std::end(buffer), a.u, base).ptr;
+					if (s.type == 'X')
+						for (auto p = buffer; p != end; ++p)
+							if (*p >= 'a' && *p <= 'f')
+								*p &= ~0x20;
+					break;
+				}
+
+				case argument::kind::floating_point:
+				{
+					const auto format = s.type == 'e' ? std::chars_format::scientific : s.type == 'f' ? std::chars_format::fixed : std::chars_format::general;
+					if (s.precision >= 0)
+						end = std::to_chars(buffer, std::end(buffer), a.f, format, s.precision).ptr;
+					else if (s.type)
+						end = std::to_chars(buffer, std::end(buffer), a.f, format).ptr;
+					else
+						end = std::to_chars(buffer, std::end(buffer), a.f).ptr;
+					break;
+				}
+
+				case argument::kind::pointer:
+					buffer[0] = '0';
+					buffer[1] = 'x';
+					end = std::to_chars(buffer + 2, std::end(buffer), reinterpret_cast<uintptr_t>(a.p), 16).ptr;
+					break;
+				}
+				write_padded(sink, s, buffer, end - buffer, true);
+			}
+
+			// formats the arguments into the sink (which must already have room for them, unless it checks for itself)
+			template <size_t count, size_t arguments, typename sink_t>
+			void write(sink_t & sink, const char * text, const std::array<piece, count> & pieces, const std::array<argument, arguments> & args)
+			{
+				for (const auto & piece : pieces)
+				{
+					if (piece.argument < 0)
+						sink.append(text + piece.offset, piece.length);
+					else
+						write(sink, piece.format, args[piece.argument]);
+				}
+			}
+
+			template <size_t count, size_t arguments>
+			size_t get_bound(const std::array<piece, count> & pieces, const std::array<argument, arguments> & args)
+			{
+				size_t bound = 0;
+				for (const auto & piece : pieces)
+					bound += piece.argument < 0 ? piece.length : get_bound(piece.format, args[piece.argument]);
+				return bound;
+			}
+
+		}
+
+	}
+
+	// appends the formatted arguments to str, with at most one allocation
+	template <typename format_source_t, typename ... Args>
+	std::string & format_append(std::string & str, format_source_t format_source, const Args & ... args)
+	{
+		constexpr int count = details::formatting::count_pieces(format_source);
+		static_assert(count >= 0, "malformed format string");
+		static_assert(details::formatting::count_arguments(format_source) == sizeof...(Args), "the number of {} fields must match the number of arguments");
+		static constexpr auto pieces = details::formatting::get_pieces<(count < 0 ? 0 : count)>(format_source);
+		const std::array<details::formatting::argument, sizeof...(Args)> arguments = { details::formatting::make_argument(args)... };
+
+		const auto length = str.size();
+		str.resize(length + details::formatting::get_bound(pieces, arguments));
+		details::formatting::unchecked_sink sink{ &str[0] + length };
+		details::formatting::write(sink, format_source(), pieces, arguments);
+		str.resize(sink.p - str.data());
+		return str;
+	}
+
+	// returns the formatted arguments
+	template <typename format_source_t, typename ... Args>
+	std::string format(format_source_t format_source, const Args & ... args)
+	{
+		std::string str;
+		format_append(str, format_source, args...);
+		return str;
+	}
+
+	// writes the formatted arguments into a character array (null terminated), returning a view of them
+	// throws std::range_error if they don't fit
+	template <size_t size, typename format_source_t, typename ... Args>
+	std::string_view format_to(char(&buffer)[size], format_source_t format_source, const Args & ... args)
+	{
+		constexpr int count = details::formatting::count_pieces(format_source);
+		static_assert(count >= 0, "malformed format string");
+		static_assert(details::formatting::count_arguments(format_source) == sizeof...(Args), "the number of {} fields must match the number of arguments");
+		static constexpr auto pieces = details::formatting::get_pieces<(count < 0 ? 0 : count)>(format_source);
+		const std::array<details::formatting::argument, sizeof...(Args)> arguments = { details::formatting::make_argument(args)... };
+
+		details::formatting::bounded_sink sink{ buffer, buffer + size - 1 };
+		details::formatting::write(sink, format_source(), pieces, arguments);
+		*sink.p = 0;
+		return std::string_view(buffer, sink.p - buffer);
+	}
+
+	// writes the formatted arguments to an output iterator (such as make_string_back_inserter()), returning the iterator
+	template <typename output_iterator_t, typename format_source_t, typename ... Args>
+	output_iterator_t format_to(output_iterator_t out, format_source_t format_source, const Args & ... args)
+	{
+		constexpr int count = details::formatting::count_pieces(format_source);
+		static_assert(count >= 0, "malformed format string");
+		static_assert(details::formatting::count_arguments(format_source) == sizeof...(Args), "the number of {} fields must match the number of arguments");
+		static constexpr auto pieces = details::formatting::get_pieces<(count < 0 ? 0 : count)>(format_source);
+		const std::array<details::formatting::argument, sizeof...(Args)> arguments = { details::formatting::make_argument(args)... };
+
+		details::formatting::iterator_sink<output_iterator_t> sink{ out };
+		details::formatting::write(sink, format_source(), pieces, arguments);
+		return sink.out;
+	}
+
+}
+
+// usage: tbx::format(TBX_FORMAT("format with {} fields"), args...)
+// the lambda keeps the format a compile time constant, so that it can be parsed and checked at compile time
+#define TBX_FORMAT(text) [] { return text; }
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// hash_string(text, seed)
+//
+//	A fast, seeded, 64 bit, non-cryptographic hash of strings, with a variant which ignores case, a
+//	constexpr variant (for hashing literals at compile time), and functors for hashed containers
+//
+//	usage:
+//		std::unordered_map<std::string, int, tbx::string_hash> counts;
+//		std::unordered_set<std::string, tbx::string_hash_no_case, tbx::string_equal_no_case> headers;
+//
+//		switch (tbx::hash_string(token))
+//		{
+//		case tbx::constexpr_hash_string("GET"): ...			// (same value, computed by the compiler)
+//		}
+//
+//	hash_string() and constexpr_hash_string() always agree, as do their _no_case versions, and
+//	hash_string_no_case(s) == hash_string_no_case(t) whenever compare_no_case(s, t) == 0.  The hash is of
+//	the characters' bytes (little endian), so it's the same on every platform, but differs between
+//	narrow and wide strings of the same text.
+//
+//	Short strings are hashed 16 bytes at a time (with a 64 x 64 -> 128 bit multiply).  Longer strings (64
+//	bytes or more) are hashed in 64 byte stripes across 8 independent accumulators (which is vectorized,
+//	using SSE2, where available), with the remainder then hashed 16 bytes at a time.  Case folding
+//	(English-only: A-Z) is done as the bytes are read, so there's never a folded copy of the string.
+//
+//	NOTE! the hash isn't designed to resist deliberate collisions (use a secret seed if that matters),
+//	and it isn't guaranteed to be stable between versions of tbx, so don't persist hashes
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace hashing {
+
+			constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87;
+			constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4F;
+			constexpr uint64_t kPrime3 = 0x165667B19E3779F9;
+			constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63;
+			constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5;
+			constexpr uint64_t kScramble = 0x9E3779B1;		// (32 bits, so that scrambling is vectorizable with SSE2)
+
+			constexpr size_t kLanes = 8;
+			constexpr size_t kStripe = kLanes * 8;			// bytes per stripe
+			constexpr size_t kStripesPerScramble = 16;
+
+			// each lane's key (before adding the seed)
+			constexpr uint64_t kKeys[kLanes] = {
+				0xBE4BA423396CFEB8, 0x1CAD21F72C81017C, 0xDB979083E96DD4DE, 0x1F67B3B7A4A44072,
+				0x78E5C0CC4EE679CB, 0x2172FFCC7DD05A82, 0x8E2443F7744608B8, 0x4C263A81E69035E0,
+			};
+
+			constexpr uint64_t kInitial[kLanes] = { kScramble, kPrime1, kPrime2, kPrime3, kPrime4, 0x85EBCA77, kPrime5, 0x9E3779B1 ^ kPrime2 };
+
+			// A-Z -> a-z in each byte of word (bytes with their top bit set are never letters)
+			constexpr uint64_t fold_word(uint64_t word)
+			{
+				constexpr uint64_t kOnes = 0x0101010101010101;
+				const auto heptets = word & (kOnes * 0x7F);
+				const auto is_upper = (heptets + kOnes * (0x80 - 'A')) & ~(heptets + kOnes * (0x80 - 'Z' - 1)) & ~word & (kOnes * 0x80);
+				return word | (is_upper >> 2);
+			}
+
+			// the 128 bit product of a and b, folded to 64 bits (high ^ low)
+			constexpr uint64_t fold_multiply_portable(uint64_t a, uint64_t b)
+			{
+#ifdef __SIZEOF_INT128__
+				const auto product = static_cast<unsigned __int128>(a) * b;
+				return uint64_t(product) ^ uint64_t(product >> 64);
+#else
+				const uint64_t a_low = uint32_t(a), a_high = a >> 32, b_low = uint32_t(b), b_high = b >> 32;
+				const auto low_low = a_low * b_low, high_low = a_high * b_low, low_high = a_low * b_high, high_high = a_high * b_high;
+				const auto cross = (low_low >> 32) + (high_low & 0xFFFFFFFF) + low_high;
+				const auto high = high_high + (high_low >> 32) + (cross >> 32);
+				const auto low = (cross << 32) | (low_low & 0xFFFFFFFF);
+				return low ^ high;
+#endif
+			}
+
+			inline uint64_t fold_multiply_intrinsic(uint64_t a, uint64_t b)
+			{
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__SIZEOF_INT128__)
+				uint64_t high;
+				const auto low = _umul128(a, b, &high);
+				return low ^ high;
+#else
+				return fold_multiply_portable(a, b);
+#endif
+			}
+
+			template <bool compile_time>
+			constexpr uint64_t fold_multiply(uint64_t a, uint64_t b)
+			{
+				if constexpr (compile_time)
+					return fold_multiply_portable(a, b);
+				else
+					return fold_multiply_intrinsic(a, b);
+			}
+
+			// accumulates one word of a stripe
+			constexpr void accumulate(uint64_t (&acc)[kLanes], size_t lane, uint64_t word, uint64_t key)
+			{
+				const auto keyed = word ^ key;
+				acc[lane ^ 1] += word;
+				acc[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+			}
+
+			constexpr void scramble(uint64_t (&acc)[kLanes], const uint64_t (&keys)[kLanes])
+			{
+				for (size_t lane = 0; lane < kLanes; ++lane)
+					acc[lane] = (acc[lane] ^ (acc[lane] >> 47) ^ keys[lane]) * kScramble;
+			}
+
+			// reads the characters as little endian bytes (constexpr, so one byte at a time)
+			template <typename T, bool fold>
+			struct char_reader
+			{
+				static constexpr bool compile_time = true;
+
+				const T * text;
+
+				constexpr uint8_t byte(size_t offset) const
+				{
+					using U = std::make_unsigned_t<T>;
+					return uint8_t(U(text[offset / sizeof(T)]) >> (8 * (offset % sizeof(T))));
+				}
+
+				constexpr uint64_t word(size_t offset, size_t count = 8) const
+				{
+					uint64_t result = 0;
+					for (size_t i = 0; i < count; ++i)
+						result |= uint64_t(byte(offset + i)) << (8 * i);
+					return fold ? fold_word(result) : result;
+				}
+			};
+
+			// reads the bytes directly (little endian only, as are all of tbx's targets)
+			template <bool fold>
+			struct byte_reader
+			{
+				static constexpr bool compile_time = false;
+
+				const uint8_t * bytes;
+
+				uint64_t word(size_t offset, size_t count = 8) const
+				{
+					// (fixed size, overlapping, reads of the final 1-7 bytes, so that memcpy is always inlined)
+					const auto p = bytes + offset;
+					uint64_t result = 0;
+					if (count == 8)
+						std::memcpy(&result, p, 8);
+					else if (count >= 4)
+					{
+						uint32_t first = 0, last = 0;
+						std::memcpy(&first, p, 4);
+						std::memcpy(&last, p + count - 4, 4);
+						result = first | (uint64_t(last) << (8 * (count - 4)));
+					}
+					else if (count)
+						result = p[0] | (uint64_t(p[count / 2]) << (8 * (count / 2))) | (uint64_t(p[count - 1]) << (8 * (count - 1)));
+					return fold ? fold_word(result) : result;
+				}
+			};
+
+			// the stripes of one scramble's worth of bytes at offset (the reference implementation)
+			template <typename reader_t>
+			constexpr void accumulate_stripes(uint64_t (&acc)[kLanes], const uint64_t (&keys)[kLanes], const reader_t & reader, size_t offset, size_t stripes)
+			{
+				for (size_t stripe = 0; stripe < stripes; ++stripe, offset += kStripe)
+					for (size_t lane = 0; lane < kLanes; ++lane)
+						accumulate(acc, lane, reader.word(offset + lane * 8), keys[lane]);
+			}
+
+#ifdef TBX_SIMD_SSE2
+			template <bool fold>
+			void accumulate_stripes(uint64_t (&acc)[kLanes], const uint64_t (&keys)[kLanes], const byte_reader<fold> & reader, size_t offset, size_t stripes)
+			{
+				__m128i vacc[kLanes / 2], vkeys[kLanes / 2];
+				for (size_t i = 0; i < kLanes / 2; ++i)
+				{
+					vacc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + 2 * i));
+					vkeys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + 2 * i));
+				}
+
+				for (size_t stripe = 0; stripe < stripes; ++stripe, offset += kStripe)
+				{
+					for (size_t i = 0; i < kLanes / 2; ++i)
+					{
+						auto data = simd::load(reader.bytes + offset + 16 * i);
+						if (fold)
+							data = simd::fold_lower<char>(data);
+						const auto keyed = _mm_xor_si128(data, vkeys[i]);
+						const auto product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));		// low * high 32 bits of each lane
+						const auto swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));								// each lane adds the other's data
+						vacc[i] = _mm_add_epi64(vacc[i], _mm_add_epi64(product, swapped));
+					}
+				}
+
+				for (size_t i = 0; i < kLanes / 2; ++i)
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(acc + 2 * i), vacc[i]);
+			}
+#endif
+
+			template <typename reader_t>
+			constexpr uint64_t hash(const reader_t & reader, size_t size, uint64_t seed)
+			{
+				constexpr auto compile_time = reader_t::compile_time;
+				auto h = seed ^ kPrime1;
+				size_t offset = 0;
+
+				if (size >= kStripe)
+				{
+					uint64_t keys[kLanes] = {};
+					uint64_t acc[kLanes] = {};
+					for (size_t lane = 0; lane < kLanes; ++lane)
+					{
+						keys[lane] = kKeys[lane] + seed;
+						acc[lane] = kInitial[lane];
+					}
+
+					for (auto stripes = size / kStripe; stripes; )
+					{
+						const auto count = stripes < kStripesPerScramble ? stripes : kStripesPerScramble;
+						accumulate_stripes(acc, keys, reader, offset, count);
+						offset += count * kStripe;
+						stripes -= count;
+						if (count == kStripesPerScramble)
+							scramble(acc, keys);
+					}
+
+					// merge the accumulators in pairs (which are independent of one another)
+					for (size_t lane = 0; lane < kLanes; lane += 2)
+						h ^= fold_multiply<compile_time>(acc[lane] ^ keys[lane], acc[lane + 1] ^ keys[lane + 1]);
+				}
+
+				// then 16 bytes at a time (the last zero padded)
+				for (; size - offset >= 16; offset += 16)
+					h ^= fold_multiply<compile_time>(reader.word(offset) ^ kPrime3, reader.word(offset + 8) ^ h ^ kPrime4);
+				if (const auto remaining = size - offset)
+				{
+					const auto low = reader.word(offset, remaining < 8 ? remaining : 8);
+					const auto high = remaining > 8 ? reader.word(offset + 8, remaining - 8) : 0;
+					h ^= fold_multiply<compile_time>(low ^ kPrime3, high ^ h ^ kPrime4);
+				}
+				// and finally mix in the length (which also avalanches the last block)
+				return fold_multiply<compile_time>(h ^ kPrime5, size ^ kPrime2);
+			}
+
+		}
+
+	}
+
+	// hashes size bytes
+	inline uint64_t hash_bytes(const void * data, size_t size, uint64_t seed = 0)
+	{
+		return details::hashing::hash(details::hashing::byte_reader<false>{ static_cast<const uint8_t *>(data) }, size, seed);
+	}
+
+	// hashes the string
+	template <typename T>
+	uint64_t hash_string(std::basic_string_view<T> text, uint64_t seed = 0) { return hash_bytes(text.data(), text.size() * sizeof(T), seed); }
+
+	template <typename T>
+	uint64_t hash_string(const T * psz, uint64_t seed = 0) { return hash_string(std::basic_string_view<T>(StringOrBlank(psz)), seed); }
+
+	template <typename T>
+	uint64_t hash_string(const std::basic_string<T> & text, uint64_t seed = 0) { return hash_string(std::basic_string_view<T>(text), seed); }
+
+	// hashes the string, ignoring case (English-only: A-Z)
+	template <typename T>
+	uint64_t hash_string_no_case(std::basic_string_view<T> text, uint64_t seed = 0)
+	{
+		return details::hashing::hash(details::hashing::byte_reader<true>{ reinterpret_cast<const uint8_t *>(text.data()) }, text.size() * sizeof(T), seed);
+	}
+
+	template <typename T>
+	uint64_t hash_string_no_case(const T * psz, uint64_t seed = 0) { return hash_string_no_case(std::basic_string_view<T>(StringOrBlank(psz)), seed); }
+
+	template <typename T>
+	uint64_t hash_string_no_case(const std::basic_string<T> & text, uint64_t seed = 0) { return hash_string_no_case(std::basic_string_view<T>(text), seed); }
+
+	// the same hashes, computed at compile time (or at least, computable at compile time)
+	template <typename T>
+	constexpr uint64_t constexpr_hash_string(std::basic_string_view<T> text, uint64_t seed = 0)
+	{
+		return details::hashing::hash(details::hashing::char_reader<T, false>{ text.data() }, text.size() * sizeof(T), seed);
+	}
+
+	template <typename T>
+	constexpr uint64_t constexpr_hash_string(const T * psz, uint64_t seed = 0) { return constexpr_hash_string(std::basic_string_view<T>(psz), seed); }
+
+	template <typename T>
+	constexpr uint64_t constexpr_hash_string_no_case(std::basic_string_view<T> text, uint64_t seed = 0)
+	{
+		return details::hashing::hash(details::hashing::char_reader<T, true>{ text.data() }, text.size() * sizeof(T), seed);
+	}
+
+	template <typename T>
+	constexpr uint64_t constexpr_hash_string_no_case(const T * psz, uint64_t seed = 0) { return constexpr_hash_string_no_case(std::basic_string_view<T>(psz), seed); }
+
+	//////////////////////////////////////////////////////////////////////////
+	// hash functors (for std::unordered_map and friends)
+	// these are transparent, so they also support heterogeneous lookups where the container does (C++20)
+	//////////////////////////////////////////////////////////////////////////
+
+	template <typename T>
+	struct basic_string_hash
+	{
+		using is_transparent = void;
+		size_t operator () (std::basic_string_view<T> text) const { return size_t(hash_string(text)); }
+	};
+
+	template <typename T>
+	struct basic_string_hash_no_case
+	{
+		using is_transparent = void;
+		size_t operator () (std::basic_string_view<T> text) const { return size_t(hash_string_no_case(text)); }
+	};
+
+	// equality which ignores case (English-only: A-Z), to go with basic_string_hash_no_case
+	template <typename T>
+	struct basic_string_equal_no_case
+	{
+		using is_transparent = void;
+		bool operator () (std::basic_string_view<T> lhs, std::basic_string_view<T> rhs) const
+		{
+			return lhs.size() == rhs.size() && compare_no_case(lhs.data(), rhs.data(), lhs.size()) == 0;
+		}
+	};
+
+	using string_hash = basic_string_hash<char>;
+	using wstring_hash = basic_string_hash<wchar_t>;
+	using string_hash_no_case = basic_string_hash_no_case<char>;
+	using wstring_hash_no_case = basic_string_hash_no_case<wchar_t>;
+	using string_equal_no_case = basic_string_equal_no_case<char>;
+	using wstring_equal_no_case = basic_string_equal_no_case<wchar_t>;
+
+}
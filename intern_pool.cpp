@@ -0,0 +1,275 @@
+#include "stdafx.h"
+#include "intern_pool.h"
+#include "hash.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace tbx {
+
+	namespace {
+
+		// the number of shards (each with its own lock and table) - must be a power of two, selected by the top bits of the hash
+		constexpr size_t kShards = 16;
+		constexpr unsigned kShardShift = 60;
+		static_assert(kShards == size_t(1) << (64 - kShardShift), "kShards must match kShardShift");
+
+		// each shard's table starts with this many slots, and doubles whenever it becomes half full
+		constexpr size_t kFirstTableSize = 64;
+
+		// the directory of symbols is a series of blocks, each twice the size of the one before
+		// (so it never moves an entry, and readers can find any entry without a lock)
+		constexpr unsigned kFirstBlockBits = 10;
+		constexpr uint32_t kMaxSymbols = uint32_t(1) << 31;
+		constexpr size_t kBlocks = 32 - kFirstBlockBits;
+
+		// strings are stored in arena blocks of this size (or larger, for a longer string)
+		constexpr size_t kArenaBlock = 64 * 1024;
+
+		struct entry
+		{
+			const char *	text;
+			uint32_t		length;
+			uint64_t		hash;
+		};
+
+		// an open addressed (linear probing) table of the symbols in a shard
+		// each slot is either 0 (empty) or the top 32 bits of the string's hash and its symbol + 1, so most
+		// mismatches are rejected without reading the entry
+		struct table
+		{
+			explicit table(size_t size) : mask(size - 1), slots(new std::atomic<uint64_t>[size])
+			{
+				for (size_t i = 0; i < size; ++i)
+					slots[i].store(0, std::memory_order_relaxed);
+			}
+
+			size_t size() const { return mask + 1; }
+
+			static uint64_t make_slot(uint64_t hash, uint32_t id) { return (hash & 0xFFFFFFFF00000000) | (uint64_t(id) + 1); }
+			static uint32_t tag_of(uint64_t hash) { return uint32_t(hash >> 32); }
+			static uint32_t id_of(uint64_t slot) { return uint32_t(slot) - 1; }
+
+			const size_t								mask;
+			const std::unique_ptr<std::atomic<uint64_t>[]>	slots;
+		};
+
+	}
+
+	struct intern_pool::impl
+	{
+		struct alignas(64) shard
+		{
+			std::mutex							mutex;
+			std::atomic<const table *>			current{ nullptr };
+			std::vector<std::unique_ptr<table>>	tables;				// the current table, and those it replaced (which readers may still be probing)
+			size_t								count = 0;			// symbols in this shard
+
+			// arena
+			std::vector<std::unique_ptr<char[]>>	blocks;
+			char *									free = nullptr;
+			size_t									available = 0;
+		};
+
+		explicit impl(case_sensitivity sensitivity) : no_case(sensitivity == case_sensitivity::no_case)
+		{
+			for (auto & s : shards)
+			{
+				s.tables.push_back(std::make_unique<table>(kFirstTableSize));
+				s.current.store(s.tables.back().get(), std::memory_order_relaxed);
+			}
+		}
+
+		~impl()
+		{
+			for (auto & block : directory)
+				delete[] block.load(std::memory_order_relaxed);
+		}
+
+		uint64_t hash_of(std::string_view text) const { return no_case ? hash_string_no_case(text) : hash_string(text); }
+
+		shard & shard_of(uint64_t hash) { return shards[hash >> kShardShift]; }
+		const shard & shard_of(uint64_t hash) const { return shards[hash >> kShardShift]; }
+
+		bool matches(const entry & e, std::string_view text) const
+		{
+			if (e.length != text.size())
+				return false;
+			return no_case ? compare_no_case(e.text, text.data(), text.size()) == 0 : std::memcmp(e.text, text.data(), text.size()) == 0;
+		}
+
+		// the directory block and offset of the given symbol
+		static unsigned block_of(uint32_t id, size_t & offset)
+		{
+			const auto biased = id + (uint32_t(1) << kFirstBlockBits);
+			const auto block = details::simd::highest_bit(biased) - kFirstBlockBits;
+			offset = biased - (uint32_t(1) << (block + kFirstBlockBits));
+			return block;
+		}
+
+		const entry & entry_of(uint32_t id) const
+		{
+			size_t offset;
+			const auto block = block_of(id, offset);
+			return directory[block].load(std::memory_order_acquire)[offset];
+		}
+
+		// (with the shard locked) returns the slot for a new entry in the shard's table, growing the table if need be
+		std::atomic<uint64_t> & insertion_slot(shard & s, uint64_t hash)
+		{
+			auto current = s.current.load(std::memory_order_relaxed);
+			if ((s.count + 1) * 2 > current->size())
+			{
+				// rehash everything into a table twice the size, which readers then switch to
+				auto grown = std::make_unique<table>(current->size() * 2);
+				for (size_t i = 0; i <= current->mask; ++i)
+					if (const auto slot = current->slots[i].load(std::memory_order_relaxed))
+						empty_slot(*grown, entry_of(table::id_of(slot)).hash).store(slot, std::memory_order_relaxed);
+				current = grown.get();
+				s.tables.push_back(std::move(grown));
+				s.current.store(current, std::memory_order_release);
+			}
+			return empty_slot(*current, hash);
+		}
+
+		static std::atomic<uint64_t> & empty_slot(const table & t, uint64_t hash)
+		{
+			auto i = hash & t.mask;
+			while (t.slots[i].load(std::memory_order_relaxed))
+				i = (i + 1) & t.mask;
+			return t.slots[i];
+		}
+
+		// (with the shard locked) copies the text into the shard's arena
+		const char * store(shard & s, std::string_view text)
+		{
+			const auto required = text.size() + 1;
+			if (required > s.available)
+			{
+				const auto size = std::max(kArenaBlock, required);
+				s.blocks.emplace_back(new char[size]);
+				s.free = s.blocks.back().get();
+				s.available = size;
+			}
+			const auto stored = s.free;
+			std::memcpy(stored, text.data(), text.size());
+			stored[text.size()] = 0;
+			s.free += required;
+			s.available -= required;
+			return stored;
+		}
+
+		// (with the shard locked) allocates a new symbol for the text
+		uint32_t add(shard & s, std::string_view text, uint64_t hash)
+		{
+			const auto id = next_id.fetch_add(1, std::memory_order_relaxed);
+			if (id >= kMaxSymbols)
+			{
+				next_id.store(kMaxSymbols, std::memory_order_relaxed);
+				throw std::length_error("intern_pool is full");
+			}
+
+			// find (or make) the directory block for it
+			size_t offset;
+			const auto block = block_of(id, offset);
+			auto entries = directory[block].load(std::memory_order_acquire);
+			if (!entries)
+			{
+				// another shard may be making it at the same time: whichever is first wins
+				auto made = new entry[size_t(1) << (block + kFirstBlockBits)];
+				if (directory[block].compare_exchange_strong(entries, made, std::memory_order_acq_rel))
+					entries = made;
+				else
+					delete[] made;
+			}
+
+			entries[offset] = { store(s, text), uint32_t(text.size()), hash };
+			return id;
+		}
+
+		// returns the symbol for the text, or symbol::none (without locking the shard)
+		symbol find(const shard & s, std::string_view text, uint64_t hash) const
+		{
+			const auto t = s.current.load(std::memory_order_acquire);
+			const auto tag = table::tag_of(hash);
+			for (auto i = hash & t->mask; ; i = (i + 1) & t->mask)
+			{
+				const auto slot = t->slots[i].load(std::memory_order_acquire);
+				if (!slot)
+					return symbol::none;
+				if (table::tag_of(slot) == tag && matches(entry_of(table::id_of(slot)), text))
+					return symbol(table::id_of(slot));
+			}
+		}
+
+		const bool								no_case;
+		std::array<shard, kShards>				shards;
+		std::array<std::atomic<entry *>, kBlocks>	directory{};
+		std::atomic<uint32_t>					next_id{ 0 };
+	};
+
+	intern_pool::intern_pool(case_sensitivity sensitivity) : m_impl(std::make_unique<impl>(sensitivity))
+	{
+	}
+
+	intern_pool::~intern_pool() = default;
+
+	symbol intern_pool::intern(std::string_view text)
+	{
+		const auto hash = m_impl->hash_of(text);
+		auto & s = m_impl->shard_of(hash);
+
+		// the fast path: it's already interned
+		auto found = m_impl->find(s, text, hash);
+		if (found != symbol::none)
+			return found;
+
+		// otherwise look again with the shard locked (another thread may have just added it)
+		std::lock_guard<std::mutex> lock(s.mutex);
+		found = m_impl->find(s, text, hash);
+		if (found != symbol::none)
+			return found;
+
+		auto & slot = m_impl->insertion_slot(s, hash);
+		const auto id = m_impl->add(s, text, hash);
+		++s.count;
+
+		// publish it (readers acquire the slot, so they see the entry and its text)
+		slot.store(table::make_slot(hash, id), std::memory_order_release);
+		return symbol(id);
+	}
+
+	symbol intern_pool::find(std::string_view text) const
+	{
+		const auto hash = m_impl->hash_of(text);
+		return m_impl->find(m_impl->shard_of(hash), text, hash);
+	}
+
+	std::string_view intern_pool::view(symbol id) const
+	{
+		if (id == symbol::none)
+			return {};
+		const auto & e = m_impl->entry_of(uint32_t(id));
+		return std::string_view(e.text, e.length);
+	}
+
+	const char * intern_pool::c_str(symbol id) const
+	{
+		return id == symbol::none ? "" : m_impl->entry_of(uint32_t(id)).text;
+	}
+
+	size_t intern_pool::size() const
+	{
+		return std::min(m_impl->next_id.load(std::memory_order_relaxed), kMaxSymbols);
+	}
+
+	bool intern_pool::is_no_case() const
+	{
+		return m_impl->no_case;
+	}
+
+}
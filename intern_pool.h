@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// intern_pool
+//
+//	Maps strings to symbols: small integers which are the same for equal strings (and different for
+//	different ones), so that comparing or hashing interned strings is an integer operation
+//
+//	usage:
+//		tbx::intern_pool keywords(tbx::case_sensitivity::no_case);
+//		const auto kItem = keywords.intern("item");
+//		...
+//		if (keywords.intern(token) == kItem)				// or find(token), which never adds a symbol
+//			...
+//		std::cout << keywords.view(symbol);
+//
+//	Symbols are allocated from 0 upwards in the order in which their strings are first interned, and each
+//	string is stored only once, null terminated, in an arena owned by the pool (so views of it and
+//	c_str() remain valid for the life of the pool).
+//
+//	Thread safety:
+//		every member function may be called concurrently.  The pool is divided into shards (by the
+//		string's hash), each with its own lock, and looking up a string which is already interned takes
+//		no lock at all - so the common case (interning a string that's been seen before) never contends.
+//
+//	NOTE! a case insensitive pool is English-only (A-Z), as with compare_no_case(), and a string's
+//	symbol keeps the spelling it was first interned with.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	// an interned string (only meaningful to the pool that interned it)
+	enum class symbol : uint32_t
+	{
+		none = 0xFFFFFFFF,		// no such string
+	};
+
+	class intern_pool
+	{
+	public:
+		explicit intern_pool(case_sensitivity sensitivity = case_sensitivity::sensitive);
+		~intern_pool();
+
+		intern_pool(const intern_pool &) = delete;
+		intern_pool & operator = (const intern_pool &) = delete;
+
+		// returns the symbol for the given string (adding it to the pool if need be)
+		// throws std::length_error if the pool is full (more than 2^31 symbols)
+		symbol intern(std::string_view text);
+
+		// returns the symbol for the given string, or symbol::none if it hasn't been interned
+		symbol find(std::string_view text) const;
+
+		// returns the string for the given symbol (which must be from this pool), or an empty string for symbol::none
+		std::string_view view(symbol id) const;
+		const char * c_str(symbol id) const;
+
+		// the number of symbols in the pool
+		size_t size() const;
+
+		// is this a case insensitive pool?
+		bool is_no_case() const;
+
+	private:
+		struct impl;
+		std::unique_ptr<impl>	m_impl;
+	};
+
+}
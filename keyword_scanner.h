@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// keyword_scanner<T>
+//
+//	Finds every occurrence of any of a set of keywords in a single pass (Aho-Corasick)
+//
+//	usage:
+//		const tbx::keyword_scanner<char> scanner({ "<item", "</item>", "id=" });
+//		scanner.scan(text, length, [](size_t keyword, size_t offset) { ... });
+//
+//	Keywords are identified by their index in the list they were given in, and each match is reported
+//	with the offset of its first character (in the order in which the matches end, so overlapping and
+//	nested keywords are all reported).  Empty keywords never match.
+//
+//	The keywords are compiled into a complete DFA: each character is mapped to a class (one per distinct
+//	keyword character, plus one for all others) and then a single lookup in a flat transition table
+//	gives the next state.  So the cost per character doesn't depend on how many keywords there are, and
+//	the table only needs as many columns as the keywords have distinct characters.
+//
+//	To scan a stream in chunks, use a stream_state to carry partial matches from one chunk to the next;
+//	offsets are then relative to the start of the stream.
+//
+//	NOTE! case insensitivity is English-only (A-Z), as with compare_no_case()
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <typename T>
+	class keyword_scanner
+	{
+	public:
+
+		// where a scan of a stream is up to
+		struct stream_state
+		{
+			uint32_t	state = 0;		// the automaton's state
+			size_t		offset = 0;		// how many characters have been scanned so far
+		};
+
+		keyword_scanner(std::initializer_list<std::basic_string_view<T>> keywords, case_sensitivity sensitivity = case_sensitivity::sensitive) :
+			keyword_scanner(keywords.begin(), keywords.end(), sensitivity)
+		{
+		}
+
+		// any range of string-like keywords (which are copied)
+		template <typename iterator_t>
+		keyword_scanner(iterator_t first, iterator_t last, case_sensitivity sensitivity = case_sensitivity::sensitive) :
+			m_no_case(sensitivity == case_sensitivity::no_case)
+		{
+			std::vector<std::basic_string<T>> keywords;
+			for (; first != last; ++first)
+			{
+				const std::basic_string_view<T> keyword(*first);
+				keywords.emplace_back(keyword.begin(), keyword.end());
+				if (m_no_case)
+					for (auto & c : keywords.back())
+						c = az_lower(c);
+			}
+			compile(keywords);
+		}
+
+		// the number of keywords (their IDs are 0 .. count - 1)
+		size_t get_keyword_count() const { return m_lengths.size(); }
+
+		// the length of the given keyword
+		size_t get_keyword_length(size_t keyword) const { return m_lengths[keyword]; }
+
+		// the number of states in the automaton (its transition table is states x classes)
+		size_t get_state_count() const { return m_match_begin.size() - 1; }
+
+		// calls on_match(keyword, offset) for each match in text[0..length)
+		template <typename callback_t>
+		void scan(const T * text, size_t length, callback_t && on_match) const
+		{
+			stream_state stream;
+			scan(stream, text, length, on_match);
+		}
+
+		template <typename callback_t>
+		void scan(std::basic_string_view<T> text, callback_t && on_match) const { scan(text.data(), text.size(), on_match); }
+
+		// scans the next chunk of a stream, calling on_match(keyword, offset) for each match which ends in it
+		template <typename callback_t>
+		void scan(stream_state & stream, const T * chunk, size_t length, callback_t && on_match) const
+		{
+			const auto classes = m_classes;
+			const auto next = m_next.data();
+			auto state = stream.state;
+			for (size_t i = 0; i < length; ++i)
+			{
+				state = next[state * classes + get_class(chunk[i])];
+
+				// report every keyword that ends here
+				for (auto match = m_match_begin[state], end = m_match_begin[state + 1]; match != end; ++match)
+				{
+					const auto keyword = m_matches[match];
+					on_match(size_t(keyword), stream.offset + i + 1 - m_lengths[keyword]);
+				}
+			}
+			stream.state = state;
+			stream.offset += length;
+		}
+
+	private:
+
+		static constexpr uint32_t kNone = ~uint32_t(0);
+
+		bool						m_no_case;
+		uint32_t					m_classes = 1;		// columns in the transition table (class 0 is any character not in a keyword)
+		std::array<uint32_t, 256>	m_narrow = {};		// the class of each character < 256
+		std::vector<std::pair<T, uint32_t>>	m_wide;		// the class of each keyword character >= 256 (sorted)
+		std::vector<uint32_t>		m_next;				// state x class -> state
+		std::vector<uint32_t>		m_match_begin;		// state -> its first entry in m_matches (plus a final end entry)
+		std::vector<uint32_t>		m_matches;			// the keywords which end at each state (including by way of failure links)
+		std::vector<size_t>			m_lengths;			// keyword -> its length
+
+		static size_t to_index(T c) { return static_cast<std::make_unsigned_t<T>>(c); }
+
+		uint32_t get_class(T c) const
+		{
+			const auto index = to_index(c);
+			if (index < m_narrow.size())
+				return m_narrow[index];
+
+			// keywords rarely use many characters beyond the first 256, so a short binary search will do
+			const auto found = std::lower_bound(m_wide.begin(), m_wide.end(), c, [](const std::pair<T, uint32_t> & entry, T c) { return to_index(entry.first) < to_index(c); });
+			return found != m_wide.end() && found->first == c ? found->second : 0;
+		}
+
+		void compile(const std::vector<std::basic_string<T>> & keywords)
+		{
+			// assign a class to each distinct (folded) keyword character
+			std::vector<T> alphabet;
+			for (const auto & keyword : keywords)
+				alphabet.insert(alphabet.end(), keyword.begin(), keyword.end());
+			std::sort(alphabet.begin(), alphabet.end(), [](T a, T b) { return to_index(a) < to_index(b); });
+			alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+			for (const auto c : alphabet)
+			{
+				const auto index = to_index(c);
+				if (index < m_narrow.size())
+				{
+					m_narrow[index] = m_classes;
+					if (m_no_case && is_lowercase(c))
+						m_narrow[to_index(az_upper(c))] = m_classes;
+				}
+				else
+					m_wide.emplace_back(c, m_classes);
+				++m_classes;
+			}
+
+			// build the trie (the state's row is kNone where there's no edge yet)
+			std::vector<std::vector<uint32_t>> outputs(1);
+			m_next.assign(m_classes, kNone);
+			for (size_t keyword = 0; keyword < keywords.size(); ++keyword)
+			{
+				m_lengths.push_back(keywords[keyword].size());
+				if (keywords[keyword].empty())
+					continue;
+
+				uint32_t state = 0;
+				for (const auto c : keywords[keyword])
+				{
+					auto & edge = m_next[state * m_classes + get_class(c)];
+					if (edge == kNone)
+					{
+						edge = static_cast<uint32_t>(outputs.size());
+						outputs.emplace_back();
+						m_next.resize(m_next.size() + m_classes, kNone);
+					}
+					state = m_next[state * m_classes + get_class(c)];
+				}
+				outputs[state].push_back(static_cast<uint32_t>(keyword));
+			}
+
+			// breadth first, fill in each missing edge with the edge from the state's failure state (the longest proper suffix
+			// of the state that is also in the trie) - which is complete already, as it's shallower - and inherit its outputs
+			std::vector<uint32_t> failure(outputs.size(), 0);
+			std::vector<uint32_t> queue;
+			for (uint32_t c = 0; c < m_classes; ++c)
+			{
+				auto & edge = m_next[c];
+				if (edge == kNone)
+					edge = 0;
+				else
+					queue.push_back(edge);
+			}
+			for (size_t head = 0; head < queue.size(); ++head)
+			{
+				const auto state = queue[head];
+				const auto fallback = failure[state];
+				outputs[state].insert(outputs[state].end(), outputs[fallback].begin(), outputs[fallback].end());
+				for (uint32_t c = 0; c < m_classes; ++c)
+				{
+					auto & edge = m_next[state * m_classes + c];
+					const auto inherited = m_next[fallback * m_classes + c];
+					if (edge == kNone)
+						edge = inherited;
+					else
+					{
+						failure[edge] = inherited;
+						queue.push_back(edge);
+					}
+				}
+			}
+
+			// flatten the outputs
+			m_match_begin.reserve(outputs.size() + 1);
+			for (const auto & output : outputs)
+			{
+				m_match_begin.push_back(static_cast<uint32_t>(m_matches.size()));
+				m_matches.insert(m_matches.end(), output.begin(), output.end());
+			}
+			m_match_begin.push_back(static_cast<uint32_t>(m_matches.size()));
+		}
+	};
+
+}
@@ -0,0 +1,531 @@
+#include "stdafx.h"
+#include "log_lanes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#include <unistd.h>
+#define TBX_LOG_LANES_WRITEV
+#else
+#include <io.h>
+#endif
+
+namespace tbx {
+
+	namespace {
+
+		// size of each thread's lane (in bytes) - must be a power of two
+		constexpr size_t kLaneCapacity = 64 * 1024;
+
+		// the most buffers we hand to a single writev()
+#if defined(TBX_LOG_LANES_WRITEV) && defined(IOV_MAX)
+		constexpr size_t kMaxVectors = IOV_MAX;
+#else
+		constexpr size_t kMaxVectors = 1024;
+#endif
+
+		//////////////////////////////////////////////////////////////////////////
+		// lane
+		//
+		//	A single producer / single consumer byte ring of records: [header][text or deferred record][padding to header alignment]
+		//	A record never wraps around the end of the ring - if one won't fit, the producer skips to the start of
+		//	the ring (leaving a header with a null stream as a marker if there is room for one)
+		//////////////////////////////////////////////////////////////////////////
+
+		class lane
+		{
+		public:
+			struct header
+			{
+				std::ostream *			stream;		// destination (nullptr marks the rest of the ring as skipped)
+				log_lanes::renderer		render;		// renders a deferred record (nullptr for text)
+				uint64_t				sequence;	// global posting order
+				size_t					length;		// length of the text (or deferred record) which follows
+			};
+
+			static constexpr size_t record_size(size_t length)
+			{
+				return (sizeof(header) + length + alignof(header) - 1) & ~(alignof(header) - 1);
+			}
+
+			// is this text small enough to ever fit in a lane?
+			static constexpr bool fits(size_t length) { return record_size(length) <= kLaneCapacity / 2; }
+
+			lane() : m_buffer(new char[kLaneCapacity]) {}
+
+			// producer: returns false if there is no room (caller must have checked fits())
+			bool push(std::ostream * stream, log_lanes::renderer render, uint64_t sequence, const char * text, size_t length)
+			{
+				const auto needed = record_size(length);
+				auto head = m_head.load(std::memory_order_relaxed);
+				const auto tail = m_tail.load(std::memory_order_acquire);
+
+				// skip the end of the ring if we don't fit there
+				const auto remaining = kLaneCapacity - (head & kMask);
+				const auto skip = remaining < needed ? remaining : 0;
+				if (head + skip + needed - tail > kLaneCapacity)
+					return false;
+
+				if (skip)
+				{
+					if (skip >= sizeof(header))
+					{
+						const header marker = { nullptr, nullptr, 0, 0 };
+						std::memcpy(m_buffer.get() + (head & kMask), &marker, sizeof(marker));
+					}
+					head += skip;
+				}
+
+				const header h = { stream, render, sequence, length };
+				auto p = m_buffer.get() + (head & kMask);
+				std::memcpy(p, &h, sizeof(h));
+				std::memcpy(p + sizeof(h), text, length);
+
+				// publish
+				m_head.store(head + needed, std::memory_order_release);
+				return true;
+			}
+
+			// how many bytes are in use (approximate from the producer's point of view)
+			size_t used() const { return m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed); }
+
+			// consumer: calls f(header, text) for each published record, and returns the tail position which follows them
+			template <typename F>
+			size_t peek(F && f) const
+			{
+				auto tail = m_tail.load(std::memory_order_relaxed);
+				const auto head = m_head.load(std::memory_order_acquire);
+				while (tail != head)
+				{
+					const auto remaining = kLaneCapacity - (tail & kMask);
+					if (remaining < sizeof(header))
+					{
+						tail += remaining;
+						continue;
+					}
+
+					header h;
+					const auto p = m_buffer.get() + (tail & kMask);
+					std::memcpy(&h, p, sizeof(h));
+					if (!h.stream)
+					{
+						tail += remaining;
+						continue;
+					}
+
+					f(h, p + sizeof(h));
+					tail += record_size(h.length);
+				}
+				return tail;
+			}
+
+			// consumer: hand the space up to tail back to the producer
+			void release(size_t tail) { m_tail.store(tail, std::memory_order_release); }
+
+			bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_relaxed); }
+
+			std::atomic<bool>	retired{ false };	// set once the owning thread has exited
+
+		private:
+			static constexpr size_t kMask = kLaneCapacity - 1;
+			static_assert((kLaneCapacity & kMask) == 0, "kLaneCapacity must be a power of two");
+
+			std::unique_ptr<char[]>				m_buffer;
+			alignas(64) std::atomic<size_t>		m_head{ 0 };	// written only by the producer
+			alignas(64) std::atomic<size_t>		m_tail{ 0 };	// written only by the consumer
+		};
+
+		//////////////////////////////////////////////////////////////////////////
+		// registry
+		//
+		//	owns the set of lanes, and the flusher thread which drains them
+		//////////////////////////////////////////////////////////////////////////
+
+		class registry
+		{
+		public:
+			static registry & get()
+			{
+				static registry instance;
+				return instance;
+			}
+
+			registry() : m_flusher([this] { run(); }) {}
+
+			// options (see log_lanes.h)
+			std::atomic<std::chrono::milliseconds::rep>	flush_interval{ 10 };
+			std::atomic<size_t>							flush_threshold{ kLaneCapacity / 2 };
+			std::atomic<log_lanes::when_full>			full_policy{ log_lanes::when_full::block };
+			std::atomic<uint64_t>						dropped{ 0 };
+
+			~registry()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_wake_mutex);
+					m_stopping = true;
+				}
+				m_wake.notify_one();
+				m_flusher.join();
+				drain();
+			}
+
+			std::shared_ptr<lane> add_lane()
+			{
+				auto p = std::make_shared<lane>();
+				std::lock_guard<std::mutex> lock(m_lanes_mutex);
+				m_lanes.push_back(p);
+				return p;
+			}
+
+			uint64_t next_sequence() { return m_sequence.fetch_add(1, std::memory_order_relaxed); }
+
+			// ask the flusher to drain soon
+			void nudge()
+			{
+				if (!m_pending.exchange(true, std::memory_order_relaxed))
+					m_wake.notify_one();
+			}
+
+			// write out everything posted so far
+			void drain()
+			{
+				std::lock_guard<std::mutex> lock(m_drain_mutex);
+				drain_locked();
+			}
+
+			// write out everything posted so far, and then the given text (which is too large for any lane)
+			void drain_and_write(std::ostream & os, const char * text, size_t length)
+			{
+				std::lock_guard<std::mutex> lock(m_drain_mutex);
+				drain_locked();
+				const line e = { 0, &os, nullptr, text, length };
+				write(&e, 1);
+				os.flush();
+			}
+
+			// write out everything posted so far, then change where os's lines are written
+			void redirect(std::ostream & os, int fd)
+			{
+				std::lock_guard<std::mutex> lock(m_drain_mutex);
+				drain_locked();
+				os.flush();
+
+				m_redirects.erase(std::remove_if(m_redirects.begin(), m_redirects.end(), [&os](const auto & e) { return e.first == &os; }), m_redirects.end());
+				if (fd != -1)
+					m_redirects.emplace_back(&os, fd);
+			}
+
+		private:
+
+			struct line
+			{
+				uint64_t				sequence;
+				std::ostream *			stream;
+				log_lanes::renderer		render;		// non-null until a deferred record has been rendered
+				const char *			text;
+				size_t					length;
+			};
+
+			void run()
+			{
+				std::unique_lock<std::mutex> lock(m_wake_mutex);
+				while (!m_stopping)
+				{
+					const auto interval = std::chrono::milliseconds(flush_interval.load(std::memory_order_relaxed));
+					m_wake.wait_for(lock, interval, [this] { return m_stopping || m_pending.load(std::memory_order_relaxed); });
+					m_pending.store(false, std::memory_order_relaxed);
+					lock.unlock();
+					drain();
+					lock.lock();
+				}
+			}
+
+			void drain_locked()
+			{
+				// snapshot the current set of lanes (and whether their threads have exited, before we look at their contents)
+				{
+					std::lock_guard<std::mutex> lock(m_lanes_mutex);
+					m_snapshot = m_lanes;
+				}
+				m_retired.resize(m_snapshot.size());
+				m_tails.resize(m_snapshot.size());
+				for (size_t i = 0; i < m_snapshot.size(); ++i)
+					m_retired[i] = m_snapshot[i]->retired.load(std::memory_order_acquire);
+
+				// gather and merge every lane's lines
+				m_lines.clear();
+				for (size_t i = 0; i < m_snapshot.size(); ++i)
+					m_tails[i] = m_snapshot[i]->peek([this](const lane::header & h, const char * text) { m_lines.push_back({ h.sequence, h.stream, h.render, text, h.length }); });
+				std::sort(m_lines.begin(), m_lines.end(), [](const line & lhs, const line & rhs) { return lhs.sequence < rhs.sequence; });
+
+				// render any deferred records (into a single buffer, so we can only point into it once they're all done)
+				m_rendered.clear();
+				m_offsets.clear();
+				for (const auto & e : m_lines)
+				{
+					if (!e.render)
+						continue;
+					m_offsets.push_back(m_rendered.size());
+					e.render(m_rendered, e.text, e.length);
+				}
+				m_offsets.push_back(m_rendered.size());
+				for (size_t i = 0, n = 0; i < m_lines.size(); ++i)
+				{
+					auto & e = m_lines[i];
+					if (!e.render)
+						continue;
+					e.text = m_rendered.data() + m_offsets[n];
+					e.length = m_offsets[n + 1] - m_offsets[n];
+					e.render = nullptr;
+					++n;
+				}
+
+				// write them out in runs for the same stream, flushing each stream that we touched at the end of the batch
+				m_streams.clear();
+				for (size_t i = 0, j = 0; i < m_lines.size(); i = j)
+				{
+					if (!m_lines[i].length)
+					{
+						j = i + 1;
+						continue;
+					}
+					const auto os = m_lines[i].stream;
+					for (j = i + 1; j < m_lines.size() && m_lines[j].stream == os && m_lines[j].length; ++j)
+						;
+					if (!write(&m_lines[i], j - i))
+						m_streams.push_back(os);
+				}
+				std::sort(m_streams.begin(), m_streams.end());
+				m_streams.erase(std::unique(m_streams.begin(), m_streams.end()), m_streams.end());
+				for (auto os : m_streams)
+					os->flush();
+
+				// only now can the lanes reuse that space
+				bool forget = false;
+				for (size_t i = 0; i < m_snapshot.size(); ++i)
+				{
+					m_snapshot[i]->release(m_tails[i]);
+					forget |= m_retired[i] && m_snapshot[i]->empty();
+				}
+
+				// forget lanes whose threads have exited and which are now empty
+				if (forget)
+				{
+					std::lock_guard<std::mutex> lock(m_lanes_mutex);
+					for (size_t i = 0; i < m_snapshot.size(); ++i)
+						if (m_retired[i] && m_snapshot[i]->empty())
+							m_lanes.erase(std::remove(m_lanes.begin(), m_lanes.end(), m_snapshot[i]), m_lanes.end());
+				}
+				m_snapshot.clear();
+			}
+
+			// write a run of lines which are all for the same stream
+			// returns true if they went to a redirected file descriptor (so there's no stream to flush)
+			bool write(const line * lines, size_t count)
+			{
+				const auto os = lines->stream;
+				const auto redirect = std::find_if(m_redirects.begin(), m_redirects.end(), [os](const auto & e) { return e.first == os; });
+				if (redirect == m_redirects.end())
+				{
+					for (size_t i = 0; i < count; ++i)
+						os->write(lines[i].text, lines[i].length);
+					return false;
+				}
+
+				write(redirect->second, lines, count);
+				return true;
+			}
+
+#ifdef TBX_LOG_LANES_WRITEV
+			// hand the lines to the OS in as few calls as possible
+			void write(int fd, const line * lines, size_t count)
+			{
+				m_vectors.resize(count);
+				for (size_t i = 0; i < count; ++i)
+					m_vectors[i] = { const_cast<char *>(lines[i].text), lines[i].length };
+
+				for (size_t next = 0; next < count; )
+				{
+					const auto written = ::writev(fd, &m_vectors[next], static_cast<int>(std::min(count - next, kMaxVectors)));
+					if (written < 0 && errno == EINTR)
+						continue;
+					if (written <= 0)
+						break;	// there's nobody to report this to, and retrying a broken descriptor won't help
+
+					// skip what was written (which may end part way through a line)
+					for (auto remaining = static_cast<size_t>(written); remaining; )
+					{
+						auto & v = m_vectors[next];
+						if (remaining < v.iov_len)
+						{
+							v.iov_base = static_cast<char *>(v.iov_base) + remaining;
+							v.iov_len -= remaining;
+							break;
+						}
+						remaining -= v.iov_len;
+						++next;
+					}
+				}
+			}
+#else
+			// there's no writev() here, so coalesce the lines and hand them to the OS in a single call
+			void write(int fd, const line * lines, size_t count)
+			{
+				m_coalesced.clear();
+				for (size_t i = 0; i < count; ++i)
+					m_coalesced.insert(m_coalesced.end(), lines[i].text, lines[i].text + lines[i].length);
+
+				for (size_t next = 0; next < m_coalesced.size(); )
+				{
+					const auto written = ::_write(fd, m_coalesced.data() + next, static_cast<unsigned>(std::min<size_t>(m_coalesced.size() - next, INT_MAX)));
+					if (written <= 0)
+						break;	// there's nobody to report this to, and retrying a broken descriptor won't help
+					next += static_cast<size_t>(written);
+				}
+			}
+#endif
+
+			std::atomic<uint64_t>				m_sequence{ 0 };
+			std::atomic<bool>					m_pending{ false };
+
+			std::mutex							m_lanes_mutex;		// guards m_lanes
+			std::vector<std::shared_ptr<lane>>	m_lanes;
+
+			std::mutex							m_drain_mutex;		// serializes draining (and guards everything below, up to m_wake_mutex)
+			std::vector<std::shared_ptr<lane>>	m_snapshot;
+			std::vector<bool>					m_retired;
+			std::vector<size_t>					m_tails;
+			std::vector<line>					m_lines;
+			std::string							m_rendered;			// the text of this batch's deferred records
+			std::vector<size_t>					m_offsets;			// where each deferred record's text starts in m_rendered
+			std::vector<std::ostream *>			m_streams;
+			std::vector<std::pair<std::ostream *, int>>	m_redirects;	// streams whose lines are written to a file descriptor instead
+#ifdef TBX_LOG_LANES_WRITEV
+			std::vector<iovec>					m_vectors;
+#else
+			std::vector<char>					m_coalesced;
+#endif
+
+			std::mutex							m_wake_mutex;		// guards m_stopping
+			std::condition_variable				m_wake;
+			bool								m_stopping = false;
+			std::thread							m_flusher;			// declared last so that it starts after everything else is ready
+		};
+
+		// this thread's lane (which is retired when this thread exits)
+		struct lane_holder
+		{
+			std::shared_ptr<lane> p = registry::get().add_lane();
+			~lane_holder() { p->retired.store(true, std::memory_order_release); }
+		};
+
+	}
+
+	namespace log_lanes {
+
+		// common implementation for post() and post_deferred()
+		static void append(std::ostream & os, renderer render, const char * text, size_t length)
+		{
+			if (!length)
+				return;
+
+			auto & r = registry::get();
+
+			// a line that can never fit in a lane is written directly (after everything which preceded it)
+			if (!lane::fits(length))
+			{
+				if (render)
+				{
+					std::string rendered;
+					render(rendered, text, length);
+					r.drain_and_write(os, rendered.data(), rendered.size());
+				}
+				else
+					r.drain_and_write(os, text, length);
+				return;
+			}
+
+			thread_local lane_holder holder;
+			auto & l = *holder.p;
+			const auto sequence = r.next_sequence();
+
+			// if our lane is full, either drop the line, or drain it ourselves (which always makes room)
+			if (!l.push(&os, render, sequence, text, length))
+			{
+				if (r.full_policy.load(std::memory_order_relaxed) == when_full::drop)
+				{
+					r.dropped.fetch_add(1, std::memory_order_relaxed);
+					r.nudge();
+					return;
+				}
+				r.drain();
+				l.push(&os, render, sequence, text, length);
+			}
+
+			// don't wait for the next interval if we're filling up
+			if (l.used() > r.flush_threshold.load(std::memory_order_relaxed))
+				r.nudge();
+		}
+
+		void post(std::ostream & os, const char * text, size_t length)
+		{
+			append(os, nullptr, text, length);
+		}
+
+		void post_deferred(std::ostream & os, renderer render, const char * record, size_t length)
+		{
+			append(os, render, record, length);
+		}
+
+		void flush()
+		{
+			registry::get().drain();
+		}
+
+		void set_flush_interval(std::chrono::milliseconds interval)
+		{
+			registry::get().flush_interval.store(interval.count(), std::memory_order_relaxed);
+		}
+
+		void set_flush_threshold(size_t bytes)
+		{
+			registry::get().flush_threshold.store(std::min(bytes, kLaneCapacity), std::memory_order_relaxed);
+		}
+
+		void set_when_full(when_full policy)
+		{
+			registry::get().full_policy.store(policy, std::memory_order_relaxed);
+		}
+
+		uint64_t get_dropped_count()
+		{
+			return registry::get().dropped.load(std::memory_order_relaxed);
+		}
+
+		void redirect(std::ostream & os, int fd)
+		{
+			registry::get().redirect(os, fd);
+		}
+
+		void redirect_standard_streams()
+		{
+			redirect(std::cout, 1);
+			redirect(std::cerr, 2);
+		}
+
+	}
+
+}
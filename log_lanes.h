@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+//////////////////////////////////////////////////////////////////////////
+// log_lanes
+//
+//	Per-thread buffered output lanes for finished lines of text (this is the machinery behind mutex_stream)
+//
+//	Each thread appends its finished lines to its own lock-free (single producer / single consumer) ring,
+//	so posting a line never takes a lock which is shared with other threads.  A background flusher
+//	periodically drains every lane, merges their lines by the order in which they were posted, and writes
+//	each line whole to its destination stream.  Hence lines are never interleaved with one another.
+//
+//	Ordering:
+//		- the lines posted by any one thread are always written in the order that thread posted them
+//		- lines posted by different threads are written in the order they were posted, except that a line
+//		  which is still being posted as a drain takes place may follow lines posted slightly after it
+//
+//	Batching:
+//		the flusher drains whenever the flush interval elapses, or sooner if any lane holds more than the flush threshold
+//		a stream may be redirected to a file descriptor, in which case each batch of its lines is handed to the OS
+//		in as few (vectored) writes as possible, bypassing the stream's own buffering entirely
+//		e.g. log_lanes::redirect_standard_streams() sends all mxout / mxerr output straight to stdout / stderr
+//
+//	WARNING:
+//		output is asynchronous, so the destination stream must outlive any lines posted to it
+//		(call log_lanes::flush() before destroying a stream that has had lines posted to it)
+//		anything posted before the end of main() is written out during static destruction
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace log_lanes {
+
+		// what to do when a thread posts a line and its lane is full
+		enum class when_full
+		{
+			block,		// wait until the lane has been drained (the default: no output is lost)
+			drop,		// discard the line (and count it - see get_dropped_count())
+		};
+
+		// renders a deferred record as text, appending it to out (see post_deferred)
+		using renderer = void (*)(std::string & out, const char * record, size_t length);
+
+		// append a finished line to the calling thread's lane, to be written to os by the flusher
+		void post(std::ostream & os, const char * text, size_t length);
+
+		// append an unformatted record to the calling thread's lane, which the flusher will render as text (using render) and then write to os
+		// this keeps the cost of formatting off of the posting thread entirely (see deferred_log.h)
+		void post_deferred(std::ostream & os, renderer render, const char * record, size_t length);
+
+		// synchronously write out everything that has been posted so far (by any thread)
+		void flush();
+
+		// the flusher drains the lanes at least this often (default 10ms)
+		void set_flush_interval(std::chrono::milliseconds interval);
+
+		// a lane which holds more than this many bytes wakes the flusher early (default half of a lane's capacity)
+		void set_flush_threshold(size_t bytes);
+
+		// what posting to a full lane does (default when_full::block)
+		void set_when_full(when_full policy);
+
+		// the number of lines discarded by when_full::drop
+		uint64_t get_dropped_count();
+
+		// write all lines posted for os directly to the given file descriptor (-1 restores writing them to os)
+		// NOTE: this flushes everything posted so far, and os itself, first - so that nothing is reordered by the change
+		void redirect(std::ostream & os, int fd);
+
+		// redirect std::cout and std::cerr (and hence mxout and mxerr) to the stdout and stderr file descriptors
+		void redirect_standard_streams();
+
+	}
+
+}
@@ -1,46 +1,143 @@
 #pragma once
 
 // inspired by: https://stackoverflow.com/questions/4446484/a-line-based-thread-safe-stdcerr-for-c/53288135#53288135
-// simply buffers all insertions to a string stream, and then flushes that to the underlying output stream
-// synchronized by a per-output stream global mutex
+// simply buffers all insertions to a thread-local line buffer, and then posts that to this thread's log lane
+// the lanes are merged and written out whole to the underlying output stream by a background flusher (see log_lanes.h)
+// NOTE: output is asynchronous - use tbx::log_lanes::flush() if you need to know that it has been written
 
+#include <climits>
+#include <cstring>
 #include <iostream>
-#include <sstream>
-#include <mutex>
-#include <map>
+#include <memory>
+#include "log_lanes.h"
 
-// we cannot use global instances as we need to create and destroy our instance in order to take and release the lock each time
+// we cannot use global instances as we need to create and destroy our instance in order to post each line as a whole
 #define mxerr tbx::mutex_stream(std::cerr)
 #define mxout tbx::mutex_stream(std::cout)
 
 namespace tbx
 {
-	class mutex_stream : public std::ostringstream
-	{
-		static inline std::mutex g_mutex;
-		static inline std::unordered_map<void*, std::mutex> g_mutexes;
+	namespace details {
+
+		//////////////////////////////////////////////////////////////////////////
+		// line_buffer
+		//
+		//	a stream buffer which accumulates one line of output in inline storage, growing onto the heap only if it must
+		//	each thread reuses a single line_buffer for all of its mutex_streams, so once it has grown to fit
+		//	the longest line that thread writes, formatting a line costs no allocations at all
+		//////////////////////////////////////////////////////////////////////////
 
-		static std::mutex & get_mutex(std::ostream & os) 
+		class line_buffer : public std::streambuf
 		{
-			std::lock_guard<std::mutex> lock(g_mutex);
-			return mutex_stream::g_mutexes[&os]; 
+		public:
+			line_buffer() { clear(); }
+
+			line_buffer(const line_buffer &) = delete;
+			line_buffer & operator = (const line_buffer &) = delete;
+
+			// the accumulated line
+			const char * data() const { return pbase(); }
+			size_t size() const { return pptr() - pbase(); }
+
+			// discard the accumulated line (retaining our capacity)
+			void clear() { setp(storage(), storage() + m_capacity); }
+
+			// is this buffer currently in use by a mutex_stream?
+			bool in_use = false;
+
+		protected:
+			int_type overflow(int_type ch) override
+			{
+				if (traits_type::eq_int_type(ch, traits_type::eof()))
+					return traits_type::not_eof(ch);
+				reserve(1);
+				*pptr() = traits_type::to_char_type(ch);
+				pbump(1);
+				return ch;
+			}
+
+			std::streamsize xsputn(const char * s, std::streamsize count) override
+			{
+				reserve(static_cast<size_t>(count));
+				std::memcpy(pptr(), s, static_cast<size_t>(count));
+				advance(static_cast<size_t>(count));
+				return count;
+			}
+
+		private:
+			static constexpr size_t kInlineCapacity = 256;
+
+			char * storage() { return m_heap ? m_heap.get() : m_inline; }
+
+			// pbump() takes an int, so step in int sized increments
+			void advance(size_t count)
+			{
+				for (; count > INT_MAX; count -= INT_MAX)
+					pbump(INT_MAX);
+				pbump(static_cast<int>(count));
+			}
+
+			// ensure that there is room for count more characters
+			void reserve(size_t count)
+			{
+				const auto used = size();
+				if (m_capacity - used >= count)
+					return;
+
+				auto capacity = m_capacity * 2;
+				while (capacity - used < count)
+					capacity *= 2;
+
+				std::unique_ptr<char[]> heap(new char[capacity]);
+				std::memcpy(heap.get(), pbase(), used);
+				m_heap = std::move(heap);
+				m_capacity = capacity;
+				setp(m_heap.get(), m_heap.get() + m_capacity);
+				advance(used);
+			}
+
+			size_t					m_capacity = kInlineCapacity;
+			std::unique_ptr<char[]>	m_heap;
+			char					m_inline[kInlineCapacity];
+		};
+
+		// the calling thread's line buffer
+		inline line_buffer & this_thread_line_buffer()
+		{
+			thread_local line_buffer buffer;
+			return buffer;
 		}
 
+	}
+
+	class mutex_stream : public std::ostream
+	{
 	public:
 		mutex_stream(std::ostream & os) 
-			: m_stream(os)
-			, m_mutex(get_mutex(os))
+			: std::ostream(nullptr)
+			, m_stream(os)
+			, m_buffer(&details::this_thread_line_buffer())
 		{
-			// lock our stream while we read attributes from it (otherwise it could be in an incoherent state with other threads writing to it)
-			std::lock_guard lock(m_mutex);
+			// if our thread's buffer is already in use (we're being used while formatting an enclosing mutex_stream's output)
+			// then we must use our own private buffer (which is the only case in which we allocate for ourselves)
+			if (m_buffer->in_use)
+			{
+				m_private = std::make_unique<details::line_buffer>();
+				m_buffer = m_private.get();
+			}
+			m_buffer->in_use = true;
+			rdbuf(m_buffer);
 
 			// copyfmt causes odd problems with lost output (so don't use for now)
 //			copyfmt(os);
 
 			// copy whatever properties are relevant
-			imbue(os.getloc());
+			// note: only the flusher writes to os, and writing doesn't alter these, so we don't need a lock to read them
+			//       (we don't copy width, as every insertion resets it, so it's inherently racy)
+			// (imbue is relatively costly, so we skip it in the usual case where we already have the same locale)
+			if (const auto loc = os.getloc(); loc != getloc())
+				imbue(loc);
 			precision(os.precision());
-			width(os.width());
 
 			// initial reasonable defaults
 			setf(std::ios::fixed, std::ios::floatfield);
@@ -48,6 +145,13 @@ namespace tbx
 
 		~mutex_stream()
 		{
+			// hand our buffer back to our thread, whether or not we post its contents
+			struct release_buffer
+			{
+				details::line_buffer * p;
+				~release_buffer() { p->clear(); p->in_use = false; }
+			} release{ m_buffer };
+
 #ifdef __cpp_lib_uncaught_exceptions
 			// do NOT try to flush ourselves if we're unwinding an exception!
 			if (std::uncaught_exceptions())
@@ -58,25 +162,14 @@ namespace tbx
 				return;
 #endif
 
-			// and don't bother if we're in a bad state
-			if (good())
-			{
-				// build the string before taking the lock
-				auto s = str();
-
-				// only output the string if non-empty
-				if (!s.empty())
-				{
-					// note: we're breaking the cardinal rule to never throw during a dtor
-					//       we'll throw if the underlying stream throws for the insertion operator
-					std::lock_guard<std::mutex> lock(m_mutex);
-					m_stream << std::move(s);
-				}
-			}
+			// only output the line if we're in a good state, and it is non-empty
+			if (good() && m_buffer->size())
+				log_lanes::post(m_stream, m_buffer->data(), m_buffer->size());
 		}
 
 	private:
-		std::ostream & m_stream;
-		std::mutex & m_mutex;
+		std::ostream &							m_stream;
+		details::line_buffer *					m_buffer;	// our thread's line buffer (or m_private)
+		std::unique_ptr<details::line_buffer>	m_private;	// only used when our thread's line buffer is already in use
 	};
 }
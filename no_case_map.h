@@ -0,0 +1,383 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "hash.h"
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// no_case_map<V>
+//
+//	A flat hash map keyed by case insensitive strings (as compare_no_case(): English-only, A-Z), for
+//	HTTP headers, INI keys, XML attribute names and the like
+//
+//	usage:
+//		tbx::no_case_map<std::string> headers;
+//		headers["Content-Type"] = "text/html";
+//		if (auto found = headers.find(name); found != headers.end())		// any string_view: nothing's copied or folded
+//			use(found.key(), found.value());
+//		for (auto [key, value] : headers)									// in insertion order
+//			...
+//
+//	The key is hashed and compared as it is (folding case on the fly), so neither lookups nor insertions
+//	make a folded copy of it, and the map keeps the spelling each key was first inserted with.
+//
+//	Layout (q.v. Abseil's SwissTable): one control byte per slot holds 7 bits of the key's hash (or marks
+//	the slot as empty or deleted), and a lookup compares a whole group of 16 control bytes at once (using
+//	SSE2, where available), so it usually only examines the one key that matches.  The slots hold indexes
+//	into a dense array of entries (in insertion order), and every key's characters are stored together in
+//	a single buffer.  So a lookup touches the control bytes and index of its slot, its entry, and its key.
+//
+//	NOTE! keys (as views) and values are invalidated by insertions (which may reallocate) and erasures
+//	(which move the last entry into the erased one's place), as are iterators
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <typename T, typename V>
+	class basic_no_case_map
+	{
+		struct entry
+		{
+			size_t		key_offset;
+			size_t		key_length;
+			V			value;
+		};
+
+	public:
+		using key_type = std::basic_string_view<T>;
+		using mapped_type = V;
+		using size_type = size_t;
+
+		// iterates the entries, in insertion order (dereferencing to a pair of the key and a reference to its value)
+		template <bool is_const>
+		class basic_iterator
+		{
+			using map_t = std::conditional_t<is_const, const basic_no_case_map, basic_no_case_map>;
+			using value_t = std::conditional_t<is_const, const V, V>;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::pair<key_type, value_t &>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = value_type;
+
+			basic_iterator() = default;
+			basic_iterator(map_t * map, size_t index) : m_map(map), m_index(index) {}
+
+			// (an iterator converts to a const_iterator)
+			operator basic_iterator<true> () const { return basic_iterator<true>(m_map, m_index); }
+
+			key_type key() const { return m_map->key_of(m_map->m_entries[m_index]); }
+			value_t & value() const { return m_map->m_entries[m_index].value; }
+			reference operator * () const { return reference(key(), value()); }
+
+			basic_iterator & operator ++ () { ++m_index; return *this; }
+			basic_iterator operator ++ (int) { auto previous = *this; ++m_index; return previous; }
+
+			bool operator == (const basic_iterator & rhs) const { return m_index == rhs.m_index && m_map == rhs.m_map; }
+			bool operator != (const basic_iterator & rhs) const { return !(*this == rhs); }
+
+		private:
+			map_t *		m_map = nullptr;
+			size_t		m_index = 0;
+		};
+
+		using iterator = basic_iterator<false>;
+		using const_iterator = basic_iterator<true>;
+
+		basic_no_case_map() = default;
+		basic_no_case_map(basic_no_case_map && rhs) noexcept { swap(rhs); }
+		basic_no_case_map & operator = (basic_no_case_map && rhs) noexcept { basic_no_case_map(std::move(rhs)).swap(*this); return *this; }
+
+		basic_no_case_map(const basic_no_case_map & rhs) : m_entries(rhs.m_entries), m_keys(rhs.m_keys), m_garbage(rhs.m_garbage) { rehash(rhs.m_capacity); }
+		basic_no_case_map & operator = (const basic_no_case_map & rhs) { return *this = basic_no_case_map(rhs); }
+
+		basic_no_case_map(std::initializer_list<std::pair<key_type, V>> entries)
+		{
+			reserve(entries.size());
+			for (const auto & e : entries)
+				try_emplace(e.first, e.second);
+		}
+
+		// capacity
+		size_t size() const { return m_entries.size(); }
+		bool empty() const { return m_entries.empty(); }
+
+		// makes room for count entries (without rehashing)
+		void reserve(size_t count)
+		{
+			m_entries.reserve(count);
+			if (count > max_load(m_capacity))
+				rehash(capacity_for(count));
+		}
+
+		void swap(basic_no_case_map & rhs) noexcept
+		{
+			std::swap(m_capacity, rhs.m_capacity);
+			std::swap(m_tombstones, rhs.m_tombstones);
+			std::swap(m_control, rhs.m_control);
+			std::swap(m_index, rhs.m_index);
+			std::swap(m_entries, rhs.m_entries);
+			std::swap(m_keys, rhs.m_keys);
+			std::swap(m_garbage, rhs.m_garbage);
+		}
+
+		void clear()
+		{
+			m_entries.clear();
+			m_keys.clear();
+			m_garbage = 0;
+			m_tombstones = 0;
+			if (m_capacity)
+				std::memset(m_control.get(), kEmpty, m_capacity + kGroup);
+		}
+
+		// iteration
+		iterator begin() { return iterator(this, 0); }
+		iterator end() { return iterator(this, m_entries.size()); }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, m_entries.size()); }
+
+		// lookup
+		iterator find(key_type key) { return iterator(this, find_entry(key)); }
+		const_iterator find(key_type key) const { return const_iterator(this, find_entry(key)); }
+		bool contains(key_type key) const { return find_entry(key) != m_entries.size(); }
+		size_t count(key_type key) const { return contains(key) ? 1 : 0; }
+
+		V & at(key_type key)
+		{
+			const auto index = find_entry(key);
+			if (index == m_entries.size())
+				throw std::out_of_range("no_case_map::at(): no such key");
+			return m_entries[index].value;
+		}
+
+		const V & at(key_type key) const { return const_cast<basic_no_case_map *>(this)->at(key); }
+
+		// insertion
+		// inserts an entry for the key with the value constructed from args (unless it's there already), returning it and whether it was inserted
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(key_type key, Args &&... args)
+		{
+			const auto hash = hash_string_no_case(key);
+			auto index = find_entry(key, hash);
+			if (index != m_entries.size())
+				return { iterator(this, index), false };
+
+			if (m_entries.size() + m_tombstones + 1 > max_load(m_capacity))
+				rehash(m_entries.size() + 1 > max_load(m_capacity) / 2 ? capacity_for(m_entries.size() + 1) : m_capacity);
+
+			m_entries.push_back({ m_keys.size(), key.size(), V(std::forward<Args>(args)...) });
+			m_keys.append(key.data(), key.size());
+			place(index, hash);
+			return { iterator(this, index), true };
+		}
+
+		template <typename value_t>
+		std::pair<iterator, bool> insert_or_assign(key_type key, value_t && value)
+		{
+			auto result = try_emplace(key, std::forward<value_t>(value));
+			if (!result.second)
+				result.first.value() = std::forward<value_t>(value);
+			return result;
+		}
+
+		V & operator [] (key_type key) { return try_emplace(key).first.value(); }
+
+		// erasure (returns the number erased)
+		size_t erase(key_type key)
+		{
+			const auto hash = hash_string_no_case(key);
+			const auto slot = find_slot(key, hash);
+			if (slot == npos)
+				return 0;
+
+			const auto index = m_index[slot];
+			set_control(slot, kDeleted);
+			++m_tombstones;
+			m_garbage += m_entries[index].key_length;
+
+			// move the last entry into the erased one's place
+			const auto last = m_entries.size() - 1;
+			if (index != last)
+			{
+				m_index[slot_of(last)] = uint32_t(index);
+				m_entries[index] = std::move(m_entries[last]);
+			}
+			m_entries.pop_back();
+			return 1;
+		}
+
+	private:
+
+		using control_t = int8_t;
+		static constexpr control_t kEmpty = -128;
+		static constexpr control_t kDeleted = -2;
+		static constexpr size_t kGroup = 16;
+		static constexpr size_t npos = ~size_t(0);
+
+		size_t								m_capacity = 0;		// slots (a power of two, at least kGroup - or 0)
+		size_t								m_tombstones = 0;	// deleted slots
+		std::unique_ptr<control_t[]>		m_control;			// per slot: empty, deleted, or the low 7 bits of its key's hash (and then a copy of the first group)
+		std::unique_ptr<uint32_t[]>			m_index;			// per slot: its entry
+		std::vector<entry>					m_entries;
+		std::basic_string<T>				m_keys;				// every key's characters
+		size_t								m_garbage = 0;		// characters in m_keys which belong to erased keys
+
+		// at most 7/8 of the slots are used
+		static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+		static size_t capacity_for(size_t count)
+		{
+			size_t capacity = kGroup;
+			while (max_load(capacity) < count)
+				capacity *= 2;
+			return capacity;
+		}
+
+		key_type key_of(const entry & e) const { return key_type(m_keys.data() + e.key_offset, e.key_length); }
+
+		static bool equal(key_type a, key_type b) { return a.size() == b.size() && compare_no_case(a.data(), b.data(), a.size()) == 0; }
+
+		static control_t tag_of(uint64_t hash) { return control_t(hash & 0x7F); }
+
+		// the slots in a group which have the given control byte / which are empty / which are empty or deleted
+		uint32_t match(size_t position, control_t tag) const
+		{
+#ifdef TBX_SIMD_SSE2
+			const auto group = details::simd::load(m_control.get() + position);
+			return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag))));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < kGroup; ++i)
+				mask |= uint32_t(m_control[position + i] == tag) << i;
+			return mask;
+#endif
+		}
+
+		uint32_t match_empty(size_t position) const { return match(position, kEmpty); }
+
+		uint32_t match_available(size_t position) const
+		{
+#ifdef TBX_SIMD_SSE2
+			return uint32_t(_mm_movemask_epi8(details::simd::load(m_control.get() + position)));
+#else
+			uint32_t mask = 0;
+			for (size_t i = 0; i < kGroup; ++i)
+				mask |= uint32_t(m_control[position + i] < 0) << i;
+			return mask;
+#endif
+		}
+
+		void set_control(size_t slot, control_t control)
+		{
+			m_control[slot] = control;
+			if (slot < kGroup)
+				m_control[slot + m_capacity] = control;
+		}
+
+		// calls visit(slot) for each slot in the key's probe sequence whose control byte is its tag, until visit() returns true (returning that slot), or we reach a group with an empty slot (returning npos)
+		template <typename visitor_t>
+		size_t probe(uint64_t hash, visitor_t && visit) const
+		{
+			if (!m_capacity)
+				return npos;
+			const auto mask = m_capacity - 1;
+			const auto tag = tag_of(hash);
+			for (size_t position = (hash >> 7) & mask, step = kGroup; ; position = (position + step) & mask, step += kGroup)
+			{
+				for (auto matches = match(position, tag); matches; matches &= matches - 1)
+				{
+					const auto slot = (position + details::simd::lowest_bit(matches)) & mask;
+					if (visit(slot))
+						return slot;
+				}
+				if (match_empty(position))
+					return npos;
+			}
+		}
+
+		size_t find_slot(key_type key, uint64_t hash) const
+		{
+			return probe(hash, [&](size_t slot) { return equal(key_of(m_entries[m_index[slot]]), key); });
+		}
+
+		size_t find_entry(key_type key, uint64_t hash) const
+		{
+			const auto slot = find_slot(key, hash);
+			return slot == npos ? m_entries.size() : m_index[slot];
+		}
+
+		size_t find_entry(key_type key) const { return find_entry(key, hash_string_no_case(key)); }
+
+		// the slot which refers to the given entry
+		size_t slot_of(size_t index) const
+		{
+			return probe(hash_string_no_case(key_of(m_entries[index])), [&](size_t slot) { return m_index[slot] == index; });
+		}
+
+		// puts the entry into the first empty or deleted slot in its probe sequence (there must be one)
+		void place(size_t index, uint64_t hash)
+		{
+			const auto mask = m_capacity - 1;
+			for (size_t position = (hash >> 7) & mask, step = kGroup; ; position = (position + step) & mask, step += kGroup)
+			{
+				if (const auto available = match_available(position))
+				{
+					const auto slot = (position + details::simd::lowest_bit(available)) & mask;
+					if (m_control[slot] == kDeleted)
+						--m_tombstones;
+					set_control(slot, tag_of(hash));
+					m_index[slot] = uint32_t(index);
+					return;
+				}
+			}
+		}
+
+		// rebuilds the table with the given number of slots (dropping all tombstones, and any erased keys' characters)
+		void rehash(size_t capacity)
+		{
+			if (m_garbage > m_keys.size() / 2)
+			{
+				std::basic_string<T> keys;
+				keys.reserve(m_keys.size() - m_garbage);
+				for (auto & e : m_entries)
+				{
+					const auto offset = keys.size();
+					keys.append(m_keys, e.key_offset, e.key_length);
+					e.key_offset = offset;
+				}
+				m_keys = std::move(keys);
+				m_garbage = 0;
+			}
+
+			m_capacity = capacity;
+			m_tombstones = 0;
+			if (!capacity)
+			{
+				m_control.reset();
+				m_index.reset();
+				return;
+			}
+
+			m_control.reset(new control_t[capacity + kGroup]);
+			m_index.reset(new uint32_t[capacity]);
+			std::memset(m_control.get(), kEmpty, capacity + kGroup);
+			for (size_t index = 0; index < m_entries.size(); ++index)
+				place(index, hash_string_no_case(key_of(m_entries[index])));
+		}
+	};
+
+	template <typename V> using no_case_map = basic_no_case_map<char, V>;
+	template <typename V> using wno_case_map = basic_no_case_map<wchar_t, V>;
+
+}
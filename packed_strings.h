@@ -0,0 +1,391 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "split.h"
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// packed_strings
+//
+//	An array of strings which are all stored, null terminated, in a single buffer, with an array of their
+//	offsets into it: so a list of keywords or file names costs two allocations (rather than one per string),
+//	4 bytes of overhead per string (rather than a whole std::string or CString), and iterating it reads
+//	memory sequentially
+//
+//	usage:
+//		tbx::packed_strings names;
+//		names.push_back("readme.txt");
+//		names.append(tbx::split(line, ";", tbx::empty_fields::skip));		// (reserves space for all of them at once)
+//		for (auto name : names)												// each a string_view
+//			...
+//		::DeleteFile(names.c_str(i));
+//
+//		// save it, and later load it (or map the file into memory, and use it in place)
+//		names.save(out);
+//		auto loaded = tbx::packed_strings::load(in);
+//		auto mapped = tbx::packed_strings_view::from_image(address, bytes);	// e.g. from MapViewOfFile() or mmap()
+//
+//	The saved image is a small header, the offsets, and then the characters, exactly as they're held in
+//	memory.  So a packed_strings_view of an image (e.g. of a memory mapped file) reads the strings where
+//	they are, without copying or parsing anything.  from_image() and load() check the image's header, its
+//	offsets and each string's terminator (so a damaged image can't lead outside of itself), and throw
+//	std::runtime_error if it isn't valid.  An image has the byte order of the machine which saved it.
+//
+//	NOTE! strings (as views or c_str()) and iterators are invalidated by anything which adds strings (which
+//	may reallocate); a packed_strings_view refers to its image (or its packed_strings), so that must outlive it
+//	The characters are limited to 4G code units in all (since offsets are 32 bits): std::length_error.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace packed_strings {
+
+			// the start of a saved image (followed by count + 1 offsets, and then the characters)
+			struct image_header
+			{
+				static constexpr uint32_t kSignature = 0x53504254;		// "TBPS"
+				static constexpr uint16_t kVersion = 1;
+
+				uint32_t	signature;
+				uint16_t	version;
+				uint16_t	char_size;
+				uint32_t	count;			// of strings
+				uint32_t	characters;		// including each string's null terminator
+			};
+
+			// iterates strings given by consecutive offsets (each string ends one before the next one starts, with its null)
+			template <typename T>
+			class iterator
+			{
+			public:
+				using iterator_category = std::random_access_iterator_tag;
+				using value_type = std::basic_string_view<T>;
+				using difference_type = std::ptrdiff_t;
+				using pointer = void;
+				using reference = value_type;
+
+				iterator() = default;
+				iterator(const T * chars, const uint32_t * offset) : m_chars(chars), m_offset(offset) {}
+
+				reference operator * () const { return value_type(m_chars + m_offset[0], m_offset[1] - m_offset[0] - 1); }
+				reference operator [] (difference_type n) const { return *(*this + n); }
+
+				iterator & operator ++ () { ++m_offset; return *this; }
+				iterator operator ++ (int) { auto previous = *this; ++m_offset; return previous; }
+				iterator & operator -- () { --m_offset; return *this; }
+				iterator operator -- (int) { auto previous = *this; --m_offset; return previous; }
+				iterator & operator += (difference_type n) { m_offset += n; return *this; }
+				iterator & operator -= (difference_type n) { m_offset -= n; return *this; }
+				iterator operator + (difference_type n) const { return iterator(m_chars, m_offset + n); }
+				iterator operator - (difference_type n) const { return iterator(m_chars, m_offset - n); }
+				friend iterator operator + (difference_type n, const iterator & it) { return it + n; }
+				difference_type operator - (const iterator & rhs) const { return m_offset - rhs.m_offset; }
+
+				bool operator == (const iterator & rhs) const { return m_offset == rhs.m_offset; }
+				bool operator != (const iterator & rhs) const { return m_offset != rhs.m_offset; }
+				bool operator < (const iterator & rhs) const { return m_offset < rhs.m_offset; }
+				bool operator > (const iterator & rhs) const { return m_offset > rhs.m_offset; }
+				bool operator <= (const iterator & rhs) const { return m_offset <= rhs.m_offset; }
+				bool operator >= (const iterator & rhs) const { return m_offset >= rhs.m_offset; }
+
+			private:
+				const T *			m_chars = nullptr;
+				const uint32_t *	m_offset = nullptr;		// of the current string (the next one's is after it)
+			};
+
+			// throws unless the offsets (count + 1 of them) describe null terminated strings which fill the characters exactly
+			template <typename T>
+			void validate(const uint32_t * offsets, size_t count, const T * chars, size_t characters)
+			{
+				if (offsets[0] != 0 || offsets[count] != characters)
+					throw std::runtime_error("packed_strings: invalid image");
+				for (size_t i = 0; i < count; ++i)
+					if (offsets[i + 1] <= offsets[i] || chars[offsets[i + 1] - 1] != T())
+						throw std::runtime_error("packed_strings: invalid image");
+			}
+
+			// replaces the contents of the vector with count elements read from the stream, in pieces
+			// throws std::runtime_error if the stream ends first
+			template <typename U>
+			void read(std::istream & in, std::vector<U> & elements, size_t count)
+			{
+				constexpr size_t kPiece = 64 * 1024;
+
+				elements.clear();
+				while (elements.size() < count)
+				{
+					const auto offset = elements.size();
+					elements.resize(offset + std::min(kPiece, count - offset));
+					if (!in.read(reinterpret_cast<char *>(elements.data() + offset), std::streamsize((elements.size() - offset) * sizeof(U))))
+						throw std::runtime_error("packed_strings: invalid image");
+				}
+			}
+
+			// the offset which must follow a string of the given length, at the given offset
+			inline uint32_t next_offset(size_t offset, size_t length)
+			{
+				if (length >= 0xFFFFFFFF - offset)
+					throw std::length_error("packed_strings: too many characters");
+				return uint32_t(offset + length + 1);
+			}
+
+			// (0, for an empty array of strings)
+			inline constexpr uint32_t kNoOffsets[1] = {};
+
+		}
+
+	}
+
+	// a read only view of packed strings: of a basic_packed_strings<T>, or of a saved image of one (e.g. memory mapped)
+	template <typename T>
+	class basic_packed_strings_view
+	{
+	public:
+		using value_type = std::basic_string_view<T>;
+		using size_type = size_t;
+		using iterator = details::packed_strings::iterator<T>;
+		using const_iterator = iterator;
+
+		basic_packed_strings_view() = default;
+		basic_packed_strings_view(const T * chars, const uint32_t * offsets, size_t count) : m_chars(chars), m_offsets(offsets), m_size(count) {}
+
+		// views a saved image (as written by basic_packed_strings<T>::save()), which must be 4 byte aligned
+		// throws std::runtime_error if it isn't a valid image
+		static basic_packed_strings_view from_image(const void * image, size_t bytes)
+		{
+			using header_t = details::packed_strings::image_header;
+
+			header_t header;
+			if (bytes < sizeof(header) || reinterpret_cast<uintptr_t>(image) % alignof(uint32_t))
+				throw std::runtime_error("packed_strings: invalid image");
+			std::memcpy(&header, image, sizeof(header));
+			if (header.signature != header_t::kSignature || header.version != header_t::kVersion || header.char_size != sizeof(T))
+				throw std::runtime_error("packed_strings: invalid image");
+			if ((bytes - sizeof(header)) / sizeof(uint32_t) <= header.count)
+				throw std::runtime_error("packed_strings: invalid image");
+
+			const auto offsets = reinterpret_cast<const uint32_t *>(static_cast<const char *>(image) + sizeof(header));
+			const auto chars = reinterpret_cast<const T *>(offsets + header.count + 1);
+			if ((bytes - sizeof(header) - (header.count + size_t(1)) * sizeof(uint32_t)) / sizeof(T) < header.characters)
+				throw std::runtime_error("packed_strings: invalid image");
+
+			details::packed_strings::validate(offsets, header.count, chars, header.characters);
+			return basic_packed_strings_view(chars, offsets, header.count);
+		}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return !m_size; }
+
+		// the number of characters, including each string's null terminator
+		size_t characters() const { return m_offsets[m_size]; }
+
+		value_type operator [] (size_t index) const { return begin()[index]; }
+		const T * c_str(size_t index) const { return m_chars + m_offsets[index]; }
+		value_type front() const { return (*this)[0]; }
+		value_type back() const { return (*this)[m_size - 1]; }
+
+		value_type at(size_t index) const
+		{
+			if (index >= m_size)
+				throw std::out_of_range("packed_strings::at(): no such string");
+			return (*this)[index];
+		}
+
+		iterator begin() const { return iterator(m_chars, m_offsets); }
+		iterator end() const { return iterator(m_chars, m_offsets + m_size); }
+
+		// the raw layout: every string's characters (each null terminated), and the count + 1 offsets of them
+		const T * chars() const { return m_chars; }
+		const uint32_t * offsets() const { return m_offsets; }
+
+		// writes the strings as an image, which from_image() (or basic_packed_strings<T>::load()) reads
+		// (check the stream's state for success)
+		void save(std::ostream & out) const
+		{
+			const details::packed_strings::image_header header = {
+				details::packed_strings::image_header::kSignature,
+				details::packed_strings::image_header::kVersion,
+				uint16_t(sizeof(T)),
+				uint32_t(m_size),
+				uint32_t(characters())
+			};
+			out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char *>(m_offsets), std::streamsize((m_size + 1) * sizeof(uint32_t)));
+			out.write(reinterpret_cast<const char *>(m_chars), std::streamsize(characters() * sizeof(T)));
+		}
+
+		friend bool operator == (const basic_packed_strings_view & lhs, const basic_packed_strings_view & rhs)
+		{
+			// (the same strings are always laid out identically)
+			return lhs.m_size == rhs.m_size
+				&& std::memcmp(lhs.m_offsets, rhs.m_offsets, (lhs.m_size + 1) * sizeof(uint32_t)) == 0
+				&& std::char_traits<T>::compare(lhs.m_chars, rhs.m_chars, lhs.characters()) == 0;
+		}
+		friend bool operator != (const basic_packed_strings_view & lhs, const basic_packed_strings_view & rhs) { return !(lhs == rhs); }
+
+	private:
+		const T *			m_chars = GetBlank<T>();
+		const uint32_t *	m_offsets = details::packed_strings::kNoOffsets;
+		size_t				m_size = 0;
+	};
+
+	template <typename T>
+	class basic_packed_strings
+	{
+	public:
+		using value_type = std::basic_string_view<T>;
+		using size_type = size_t;
+		using view_type = basic_packed_strings_view<T>;
+		using iterator = details::packed_strings::iterator<T>;
+		using const_iterator = iterator;
+
+		basic_packed_strings() = default;
+		basic_packed_strings(std::initializer_list<value_type> strings) { append(strings); }
+
+		basic_packed_strings(const basic_packed_strings &) = default;
+		basic_packed_strings & operator = (const basic_packed_strings &) = default;
+
+		// (leaving rhs empty: which still has the end's offset)
+		basic_packed_strings(basic_packed_strings && rhs) : basic_packed_strings() { swap(rhs); }
+		basic_packed_strings & operator = (basic_packed_strings && rhs) { basic_packed_strings(std::move(rhs)).swap(*this); return *this; }
+
+		void swap(basic_packed_strings & rhs) noexcept
+		{
+			m_chars.swap(rhs.m_chars);
+			m_offsets.swap(rhs.m_offsets);
+		}
+
+		// copies the strings of a view (e.g. of a memory mapped image)
+		explicit basic_packed_strings(const view_type & strings) :
+			m_chars(strings.chars(), strings.chars() + strings.characters()),
+			m_offsets(strings.offsets(), strings.offsets() + strings.size() + 1)
+		{
+		}
+
+		// reads an image written by save()
+		// throws std::runtime_error if it isn't a valid image (or can't be read)
+		static basic_packed_strings load(std::istream & in)
+		{
+			using header_t = details::packed_strings::image_header;
+
+			header_t header;
+			if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.signature != header_t::kSignature || header.version != header_t::kVersion || header.char_size != sizeof(T))
+				throw std::runtime_error("packed_strings: invalid image");
+
+			// (a piece at a time, so a damaged header can't have us allocate more than the stream holds)
+			basic_packed_strings strings;
+			details::packed_strings::read(in, strings.m_offsets, header.count + size_t(1));
+			details::packed_strings::read(in, strings.m_chars, header.characters);
+
+			details::packed_strings::validate(strings.m_offsets.data(), header.count, strings.m_chars.data(), strings.m_chars.size());
+			return strings;
+		}
+
+		void save(std::ostream & out) const { view().save(out); }
+
+		view_type view() const { return view_type(m_chars.data(), m_offsets.data(), size()); }
+		operator view_type () const { return view(); }
+
+		size_t size() const { return m_offsets.size() - 1; }
+		bool empty() const { return m_offsets.size() == 1; }
+		size_t characters() const { return m_chars.size(); }
+
+		value_type operator [] (size_t index) const { return view()[index]; }
+		value_type at(size_t index) const { return view().at(index); }
+		const T * c_str(size_t index) const { return m_chars.data() + m_offsets[index]; }
+		value_type front() const { return view().front(); }
+		value_type back() const { return view().back(); }
+
+		iterator begin() const { return view().begin(); }
+		iterator end() const { return view().end(); }
+
+		void push_back(value_type text)
+		{
+			const auto offset = details::packed_strings::next_offset(m_chars.size(), text.size());
+			m_offsets.push_back(offset);
+			try
+			{
+				m_chars.insert(m_chars.end(), text.begin(), text.end());
+				m_chars.push_back(T());
+			}
+			catch (...)
+			{
+				m_offsets.pop_back();
+				m_chars.resize(m_offsets.back());
+				throw;
+			}
+		}
+		void push_back(const T * text) { push_back(value_type(StringOrBlank(text))); }
+
+		// appends each string of a range (e.g. a std::vector<std::string>), having reserved space for all of them
+		template <typename range_t>
+		void append(const range_t & strings)
+		{
+			size_t count = 0, characters = 0;
+			for (const value_type text : strings)
+				++count, characters += text.size() + 1;
+			reserve(size() + count, m_chars.size() + characters);
+			for (const value_type text : strings)
+				push_back(text);
+		}
+
+		// appends the fields of a split, having reserved space for all of their characters (which can't exceed the text's)
+		void append(const split_range<T> & fields)
+		{
+			m_chars.reserve(m_chars.size() + fields.text().size() + 1);
+			for (const auto field : fields)
+				push_back(field);
+		}
+
+		void pop_back()
+		{
+			m_offsets.pop_back();
+			m_chars.resize(m_offsets.back());
+		}
+
+		void reserve(size_t strings, size_t characters)
+		{
+			m_offsets.reserve(strings + 1);
+			m_chars.reserve(characters);
+		}
+
+		void clear()
+		{
+			m_chars.clear();
+			m_offsets.resize(1);
+		}
+
+		void shrink_to_fit()
+		{
+			m_chars.shrink_to_fit();
+			m_offsets.shrink_to_fit();
+		}
+
+		friend bool operator == (const basic_packed_strings & lhs, const basic_packed_strings & rhs) { return lhs.view() == rhs.view(); }
+		friend bool operator != (const basic_packed_strings & lhs, const basic_packed_strings & rhs) { return !(lhs == rhs); }
+
+	private:
+		std::vector<T>			m_chars;
+		std::vector<uint32_t>	m_offsets = { 0 };		// of each string, and then of the end
+	};
+
+	using packed_strings = basic_packed_strings<char>;
+	using wpacked_strings = basic_packed_strings<wchar_t>;
+	using packed_strings_view = basic_packed_strings_view<char>;
+	using wpacked_strings_view = basic_packed_strings_view<wchar_t>;
+
+}
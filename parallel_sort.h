@@ -0,0 +1,327 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "strings.h"
+#include "string_sort.h"
+
+//////////////////////////////////////////////////////////////////////////
+// parallel_sort(first, last, comp)
+// parallel_sort_strings(first, last, sensitivity)
+//
+//	Sorts across several threads: each sorts a chunk of the range (with std::sort), and then the chunks are
+//	merged in rounds, with every thread merging an equal share of each round's output
+//
+//	usage:
+//		tbx::parallel_sort(records.begin(), records.end(), [](auto & a, auto & b) { return a.id < b.id; });
+//		tbx::parallel_sort_strings(names.begin(), names.end(), tbx::case_sensitivity::no_case);
+//
+//		// natural order (q.v. Toolbox::alphanumkey()): make the keys once, then sort those as bytes
+//		tbx::parallel_sort_strings(keys.begin(), keys.end());
+//
+//	parallel_sort_strings() sorts anything which is string-like (std::basic_string, basic_string_view, or
+//	const T *): as compare() does, or as compare_no_case() does.  It sorts a record for each string, which
+//	holds the first 8 bytes' worth of the string (folded, if need be, and packed so that they compare as
+//	a single integer) beside a view of it.  So most comparisons are decided by the prefixes without
+//	touching the strings (which tend to be scattered about memory), and then the strings are put into
+//	the order of the sorted records, moving each one once.
+//
+//	threads is the most threads to use (0 is one per hardware thread), and small ranges aren't split up.
+//	Elements must be default constructible (for the merge buffer) as well as movable.  Like std::sort(),
+//	neither is stable, and if the comparison throws, the range is left in an unspecified order (and the
+//	first exception is rethrown, once every thread has finished).
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace parallel {
+
+			// the least elements worth giving a thread of their own
+			constexpr size_t kMinPerTask = 16 * 1024;
+
+			inline size_t task_count(size_t elements, unsigned threads)
+			{
+				if (!threads)
+					threads = std::max(1u, std::thread::hardware_concurrency());
+				return std::max<size_t>(1, std::min<size_t>(threads, elements / kMinPerTask));
+			}
+
+			// calls task(i) for each i in [0, count), each on its own thread (the last on this one)
+			template <typename task_t>
+			void run_tasks(size_t count, task_t && task)
+			{
+				std::mutex mutex;
+				std::exception_ptr error;
+				const auto run = [&](size_t i) {
+					try
+					{
+						task(i);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (!error)
+							error = std::current_exception();
+					}
+				};
+
+				std::vector<std::thread> threads;
+				threads.reserve(count);
+				for (size_t i = 0; i + 1 < count; ++i)
+				{
+					try
+					{
+						threads.emplace_back(run, i);
+					}
+					catch (const std::system_error &)
+					{
+						// (out of threads: do it on this one)
+						run(i);
+					}
+				}
+				run(count - 1);
+
+				for (auto & thread : threads)
+					thread.join();
+				if (error)
+					std::rethrow_exception(error);
+			}
+
+			// the number of elements of a (of length a_size) among the first k elements of the merge of a and b
+			// (on ties, a's elements come first, as with std::merge)
+			template <typename iterator_t, typename compare_t>
+			size_t co_rank(size_t k, iterator_t a, size_t a_size, iterator_t b, size_t b_size, compare_t & comp)
+			{
+				auto low = k > b_size ? k - b_size : 0;
+				auto high = std::min(k, a_size);
+				while (low < high)
+				{
+					const auto middle = low + (high - low) / 2;
+					if (!comp(b[k - middle - 1], a[middle]))
+						low = middle + 1;
+					else
+						high = middle;
+				}
+				return low;
+			}
+
+			// merges [a, a_last) and [b, b_last) by moving them into destination (comparing the elements where they are,
+			// as lvalues, so comparators which take non-const references work here as they do with std::sort())
+			template <typename source_t, typename destination_t, typename compare_t>
+			void move_merge(source_t a, source_t a_last, source_t b, source_t b_last, destination_t destination, compare_t & comp)
+			{
+				while (a != a_last && b != b_last)
+				{
+					// (on ties, a's elements come first, as with std::merge)
+					if (comp(*b, *a))
+						*destination++ = std::move(*b++);
+					else
+						*destination++ = std::move(*a++);
+				}
+				destination = std::move(a, a_last, destination);
+				std::move(b, b_last, destination);
+			}
+
+			// merges adjacent pairs of the sorted runs in source (which start at bounds) into destination, with
+			// each task merging an equal share of the output, and then drops every other bound
+			template <typename source_t, typename destination_t, typename compare_t>
+			void merge_round(source_t source, destination_t destination, std::vector<size_t> & bounds, size_t tasks, compare_t & comp)
+			{
+				const auto runs = bounds.size() - 1;
+				const auto size = bounds.back();
+				const auto share = [&](size_t task) { return size * task / tasks; };
+
+				// first, where each share of the output starts within the pair of runs it's in (before any
+				// task starts moving elements out of the source, which would upset the comparisons)
+				std::vector<size_t> splits(tasks + 1);
+				for (size_t task = 1; task < tasks; ++task)
+				{
+					const auto output = share(task);
+					const auto run = size_t(std::upper_bound(bounds.begin(), bounds.end(), output) - bounds.begin() - 1) & ~size_t(1);
+					const auto pair_first = bounds[run], pair_middle = bounds[run + 1], pair_last = bounds[std::min(run + 2, runs)];
+					splits[task] = co_rank(output - pair_first, source + pair_first, pair_middle - pair_first, source + pair_middle, pair_last - pair_middle, comp);
+				}
+
+				run_tasks(tasks, [&](size_t task) {
+					const auto output_first = share(task);
+					const auto output_last = share(task + 1);
+
+					// each pair of runs which overlaps this task's share of the output
+					for (size_t run = 0; run < runs; run += 2)
+					{
+						const auto pair_first = bounds[run];
+						const auto pair_middle = bounds[run + 1];
+						const auto pair_last = bounds[std::min(run + 2, runs)];
+						if (pair_last <= output_first || pair_first >= output_last)
+							continue;
+
+						const auto a = source + pair_first, b = source + pair_middle;
+						const auto a_size = pair_middle - pair_first;
+						const auto k_first = std::max(output_first, pair_first) - pair_first;
+						const auto k_last = std::min(output_last, pair_last) - pair_first;
+						const auto i_first = output_first > pair_first ? splits[task] : 0;
+						const auto i_last = output_last < pair_last ? splits[task + 1] : a_size;
+
+						move_merge(a + i_first, a + i_last, b + (k_first - i_first), b + (k_last - i_last), destination + (pair_first + k_first), comp);
+					}
+				});
+
+				std::vector<size_t> merged;
+				for (size_t i = 0; i < bounds.size(); i += 2)
+					merged.push_back(bounds[i]);
+				if (merged.back() != size)
+					merged.push_back(size);
+				bounds.swap(merged);
+			}
+
+			template <typename iterator_t, typename compare_t>
+			void merge_sort(iterator_t first, iterator_t last, compare_t comp, size_t tasks)
+			{
+				using value_t = typename std::iterator_traits<iterator_t>::value_type;
+
+				const auto size = size_t(last - first);
+				std::vector<size_t> bounds;
+				for (size_t task = 0; task <= tasks; ++task)
+					bounds.push_back(size * task / tasks);
+
+				run_tasks(tasks, [&](size_t task) { std::sort(first + bounds[task], first + bounds[task + 1], comp); });
+
+				// merge the runs back and forth between the range and a buffer, until there's one
+				std::vector<value_t> buffer(size);
+				bool in_buffer = false;
+				while (bounds.size() > 2)
+				{
+					if (in_buffer)
+						merge_round(buffer.begin(), first, bounds, tasks, comp);
+					else
+						merge_round(first, buffer.begin(), bounds, tasks, comp);
+					in_buffer = !in_buffer;
+				}
+
+				if (in_buffer)
+					run_tasks(tasks, [&](size_t task) {
+						const auto from = size * task / tasks, to = size * (task + 1) / tasks;
+						std::move(buffer.begin() + from, buffer.begin() + to, first + from);
+					});
+			}
+
+			// a string, and as many of its first characters as fit in 64 bits, packed so that they compare as the string does
+			template <typename T>
+			struct string_record
+			{
+				static constexpr size_t kPrefixLength = sizeof(uint64_t) / sizeof(T);
+
+				uint64_t	prefix;
+				const T *	data;
+				size_t		length;
+				size_t		index;		// of the element
+			};
+
+			// each character as an unsigned value which orders as compare() or compare_no_case() does (q.v. string_sort::order<>)
+			template <typename T, bool no_case>
+			uint64_t ordinal_of(T ch)
+			{
+				using order_t = details::string_sort::order<T, no_case>;
+				using U = typename order_t::U;
+				return U(U(no_case ? az_upper(ch) : ch) ^ order_t::kSignBit);
+			}
+
+			template <typename T, bool no_case>
+			struct string_record_less
+			{
+				bool operator () (const string_record<T> & a, const string_record<T> & b) const
+				{
+					if (a.prefix != b.prefix)
+						return a.prefix < b.prefix;
+
+					// equal prefixes (which are zero padded), so if either is entirely in its prefix, the shorter is first
+					constexpr auto k = string_record<T>::kPrefixLength;
+					if (a.length <= k || b.length <= k)
+						return a.length < b.length;
+
+					const std::basic_string_view<T> rest_a(a.data + k, a.length - k), rest_b(b.data + k, b.length - k);
+					return (no_case ? compare_no_case(rest_a, rest_b) : compare(rest_a, rest_b)) < 0;
+				}
+			};
+
+			template <bool no_case, typename iterator_t>
+			void sort_strings(iterator_t first, iterator_t last, unsigned threads)
+			{
+				using view_t = decltype(details::string_sort::view_of(*first));
+				using T = typename view_t::value_type;
+				using record_t = string_record<T>;
+				using value_t = typename std::iterator_traits<iterator_t>::value_type;
+
+				const auto size = size_t(last - first);
+				const auto tasks = task_count(size, threads);
+
+				std::vector<record_t> records(size);
+				run_tasks(tasks, [&](size_t task) {
+					for (size_t i = size * task / tasks, end = size * (task + 1) / tasks; i != end; ++i)
+					{
+						const auto view = details::string_sort::view_of(first[i]);
+						uint64_t prefix = 0;
+						for (size_t j = 0; j < record_t::kPrefixLength; ++j)
+							prefix = (prefix << (8 * sizeof(T))) | (j < view.size() ? ordinal_of<T, no_case>(view[j]) : 0);
+						records[i] = { prefix, view.data(), view.size(), i };
+					}
+				});
+
+				const string_record_less<T, no_case> less;
+				if (tasks == 1)
+					std::sort(records.begin(), records.end(), less);
+				else
+					merge_sort(records.begin(), records.end(), less, tasks);
+
+				// then put the elements in the order of their records
+				std::vector<value_t> sorted(size);
+				run_tasks(tasks, [&](size_t task) {
+					for (size_t i = size * task / tasks, end = size * (task + 1) / tasks; i != end; ++i)
+						sorted[i] = std::move(first[records[i].index]);
+				});
+				run_tasks(tasks, [&](size_t task) {
+					const auto from = size * task / tasks, to = size * (task + 1) / tasks;
+					std::move(sorted.begin() + from, sorted.begin() + to, first + from);
+				});
+			}
+
+		}
+
+	}
+
+	// sorts [first, last) using up to threads threads (0 for one per hardware thread)
+	template <typename iterator_t, typename compare_t = std::less<>>
+	void parallel_sort(iterator_t first, iterator_t last, compare_t comp = compare_t(), unsigned threads = 0)
+	{
+		const auto tasks = details::parallel::task_count(size_t(last - first), threads);
+		if (tasks == 1)
+			std::sort(first, last, comp);
+		else
+			details::parallel::merge_sort(first, last, comp, tasks);
+	}
+
+	// sorts [first, last) of strings (std::basic_string, basic_string_view or const T *), as compare() or compare_no_case() orders them
+	template <typename iterator_t>
+	void parallel_sort_strings(iterator_t first, iterator_t last, case_sensitivity sensitivity = case_sensitivity::sensitive, unsigned threads = 0)
+	{
+		if (sensitivity == case_sensitivity::no_case)
+			details::parallel::sort_strings<true>(first, last, threads);
+		else
+			details::parallel::sort_strings<false>(first, last, threads);
+	}
+
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include "core.h"
+#include "hash.h"
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// perfect_set<K, N>
+//
+//	A constant set of integers or strings, with a perfect hash computed by the compiler, so a lookup is one
+//	hash, one table lookup and a single comparison (however many keys there are), with no runtime setup
+//
+//	usage:
+//		constexpr auto kKeywords = tbx::make_perfect_set({ "break", "case", "continue", "while" });
+//		switch (kKeywords.find(token))								// the index of the keyword, or kKeywords.npos
+//		{
+//		case kKeywords.index_of("while"): ...						// (computed by the compiler, which rejects unknown keys)
+//		}
+//
+//		constexpr auto kMethods = tbx::make_perfect_set_no_case({ "GET", "HEAD", "POST" });
+//		constexpr auto kPorts = tbx::make_perfect_set({ 80, 443, 8080, 8443 });
+//		if (tbx::isoneof(port, kPorts)) ...
+//
+//	Keys are identified by their index in the list they were given in.  String keys are string_views, so
+//	the set refers to (rather than copies) its keys: give it literals, or other strings which outlive it.
+//	Case insensitivity is English-only (A-Z), as with compare_no_case().  Duplicate keys are an error (at
+//	compile time, since the set is constexpr).
+//
+//	The hash is "hash and displace" (q.v. PTHash): each key's hash selects a bucket, and each bucket has a
+//	pilot value (found when the set is built) which displaces all of its keys into free slots of a table
+//	(of twice as many slots as there are keys).  So a lookup goes from the key's hash, via its bucket's
+//	pilot, to the only slot its key could be in, and then compares the key there.
+//
+//	NOTE! building a large set at compile time takes many constexpr evaluation steps: sets of more than a
+//	few hundred strings may need the compiler's limit raising (/constexpr:steps or -fconstexpr-ops-limit)
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace perfect_hash {
+
+			// slots (a power of two, at least twice the number of keys, so a table is at most half full)
+			constexpr size_t table_size(size_t keys)
+			{
+				size_t size = 2;
+				while (size < 2 * keys)
+					size *= 2;
+				return size;
+			}
+
+			// buckets (a power of two, about half the number of keys)
+			constexpr size_t bucket_count(size_t keys)
+			{
+				size_t count = 1;
+				while (count * 2 < keys)
+					count *= 2;
+				return count;
+			}
+
+			constexpr unsigned log2(size_t power_of_two)
+			{
+				unsigned bits = 0;
+				while (power_of_two >>= 1)
+					++bits;
+				return bits;
+			}
+
+			// a bijective 64 bit mixer (so integer keys, which are often sequential, are spread over the table)
+			constexpr uint64_t mix(uint64_t x)
+			{
+				x ^= x >> 32;
+				x *= 0xD6E8FEB86659FD93;
+				x ^= x >> 32;
+				x *= 0xD6E8FEB86659FD93;
+				x ^= x >> 32;
+				return x;
+			}
+
+			// the slot of a key with the given hash, in a table of 2^bits slots, given its bucket's pilot
+			constexpr size_t position(uint64_t hash, uint64_t pilot, unsigned bits)
+			{
+				return size_t(((hash ^ pilot) * hashing::kPrime2) >> (64 - bits));
+			}
+
+			// the key type for each type of key given: strings are string_views
+			template <typename K> struct key_of { using type = K; };
+			template <typename T> struct key_of<const T *> { using type = std::basic_string_view<T>; };
+			template <typename T> struct key_of<T *> { using type = std::basic_string_view<T>; };
+			template <typename T> struct key_of<std::basic_string_view<T>> { using type = std::basic_string_view<T>; };
+			template <typename K> using key_of_t = typename key_of<K>::type;
+
+			template <typename K> struct is_string_key : std::false_type {};
+			template <typename T> struct is_string_key<std::basic_string_view<T>> : std::true_type {};
+
+			template <typename T>
+			constexpr T fold(T ch) { return ch >= T('A') && ch <= T('Z') ? T(ch | 0x20) : ch; }
+
+			// key equality, as the set's lookups see it (at compile time)
+			template <typename K, bool no_case>
+			constexpr bool equal(const K & a, const K & b)
+			{
+				if constexpr (is_string_key<K>::value && no_case)
+				{
+					if (a.size() != b.size())
+						return false;
+					for (size_t i = 0; i < a.size(); ++i)
+						if (fold(a[i]) != fold(b[i]))
+							return false;
+					return true;
+				}
+				else
+					return a == b;
+			}
+
+		}
+
+	}
+
+	template <typename K, size_t N, case_sensitivity sensitivity = case_sensitivity::sensitive>
+	class perfect_set
+	{
+		static_assert(N > 0, "perfect_set<> requires at least one key");
+		static_assert(N <= 0xFFFF, "perfect_set<> supports up to 65535 keys");
+		static_assert(std::is_integral_v<K> || std::is_enum_v<K> || details::perfect_hash::is_string_key<K>::value, "perfect_set<> requires integer, enum or string keys");
+
+		static constexpr bool kNoCase = sensitivity == case_sensitivity::no_case;
+		static constexpr size_t kTableSize = details::perfect_hash::table_size(N);
+		static constexpr unsigned kTableBits = details::perfect_hash::log2(kTableSize);
+		static constexpr size_t kBuckets = details::perfect_hash::bucket_count(N);
+		static constexpr uint32_t kMaxPilots = 1 << 20;
+
+	public:
+		using key_type = K;
+
+		static constexpr size_t npos = ~size_t(0);
+
+		constexpr explicit perfect_set(const std::array<K, N> & keys) : m_keys(keys)
+		{
+			using namespace details::perfect_hash;
+
+			// hash the keys, and sort them by bucket (counting sort)
+			uint64_t hashes[N] = {};
+			size_t bucket_sizes[kBuckets] = {};
+			for (size_t i = 0; i < N; ++i)
+			{
+				hashes[i] = hash_of<true>(keys[i]);
+				++bucket_sizes[hashes[i] & (kBuckets - 1)];
+			}
+
+			size_t bucket_start[kBuckets + 1] = {};
+			size_t largest = 0;
+			for (size_t b = 0; b < kBuckets; ++b)
+			{
+				bucket_start[b + 1] = bucket_start[b] + bucket_sizes[b];
+				if (bucket_sizes[b] > largest)
+					largest = bucket_sizes[b];
+			}
+
+			size_t members[N] = {};
+			size_t filled[kBuckets] = {};
+			for (size_t i = 0; i < N; ++i)
+			{
+				const auto b = hashes[i] & (kBuckets - 1);
+				members[bucket_start[b] + filled[b]++] = i;
+			}
+
+			// then place the buckets, largest first (while the table is emptiest), each with the first pilot which puts all its keys in free slots
+			bool occupied[kTableSize] = {};
+			size_t slots[N] = {};
+			for (auto size = largest; size; --size)
+			{
+				for (size_t b = 0; b < kBuckets; ++b)
+				{
+					if (bucket_sizes[b] != size)
+						continue;
+
+					const auto first = members + bucket_start[b];
+					for (size_t i = 0; i < size; ++i)
+						for (size_t j = i + 1; j < size; ++j)
+							if (hashes[first[i]] == hashes[first[j]] && details::perfect_hash::equal<K, kNoCase>(keys[first[i]], keys[first[j]]))
+								throw std::invalid_argument("perfect_set: duplicate key");
+
+					for (uint32_t attempt = 0; ; ++attempt)
+					{
+						if (attempt == kMaxPilots)
+							throw std::logic_error("perfect_set: no perfect hash found");
+
+						const auto pilot = mix(attempt);
+						bool fits = true;
+						for (size_t i = 0; i < size && fits; ++i)
+						{
+							slots[i] = position(hashes[first[i]], pilot, kTableBits);
+							fits = !occupied[slots[i]];
+							for (size_t j = 0; j < i && fits; ++j)
+								fits = slots[j] != slots[i];
+						}
+						if (!fits)
+							continue;
+
+						m_pilots[b] = pilot;
+						for (size_t i = 0; i < size; ++i)
+						{
+							occupied[slots[i]] = true;
+							m_slots[slots[i]] = uint16_t(first[i]);
+						}
+						break;
+					}
+				}
+			}
+		}
+
+		static constexpr size_t size() { return N; }
+		constexpr const std::array<K, N> & keys() const { return m_keys; }
+
+		// returns the index of the key, or npos
+		constexpr size_t find(const K & key) const
+		{
+			const auto hash = hash_of<false>(key);
+			const auto index = m_slots[details::perfect_hash::position(hash, m_pilots[hash & (kBuckets - 1)], kTableBits)];
+
+			// (empty slots refer to key 0, so there's always exactly one comparison)
+			return equal(m_keys[index], key) ? index : npos;
+		}
+
+		template <typename T = K, typename = std::enable_if_t<details::perfect_hash::is_string_key<T>::value>>
+		size_t find(const std::basic_string<typename T::value_type> & key) const { return find(K(key)); }
+
+		template <typename T = K, typename = std::enable_if_t<details::perfect_hash::is_string_key<T>::value>>
+		size_t find(const typename T::value_type * key) const { return find(K(StringOrBlank(key))); }
+
+		template <typename U>
+		constexpr bool contains(const U & key) const { return find(key) != npos; }
+
+		// returns the index of a key which must be in the set (for use at compile time, e.g. as a case label)
+		constexpr size_t index_of(const K & key) const
+		{
+			for (size_t i = 0; i < N; ++i)
+				if (details::perfect_hash::equal<K, kNoCase>(m_keys[i], key))
+					return i;
+			throw std::invalid_argument("perfect_set: no such key");
+		}
+
+	private:
+
+		// hashes a key (at compile time, or as fast as possible at runtime - which agree)
+		template <bool compile_time>
+		static constexpr uint64_t hash_of(const K & key)
+		{
+			if constexpr (!details::perfect_hash::is_string_key<K>::value)
+				return details::perfect_hash::mix(uint64_t(key));
+			else if constexpr (compile_time)
+				return kNoCase ? constexpr_hash_string_no_case(key) : constexpr_hash_string(key);
+			else
+				return kNoCase ? hash_string_no_case(key) : hash_string(key);
+		}
+
+		static constexpr bool equal(const K & a, const K & b)
+		{
+			if constexpr (details::perfect_hash::is_string_key<K>::value && kNoCase)
+				return a.size() == b.size() && compare_no_case(a.data(), b.data(), a.size()) == 0;
+			else
+				return a == b;
+		}
+
+		std::array<K, N>					m_keys;
+		std::array<uint64_t, kBuckets>		m_pilots{};
+		std::array<uint16_t, kTableSize>	m_slots{};		// per slot: the index of its key (or 0, when it's empty)
+	};
+
+	// makes a perfect_set of the keys (integers, enums, string literals or string_views)
+	template <typename K, size_t N>
+	constexpr auto make_perfect_set(const K (&keys)[N])
+	{
+		using key_t = details::perfect_hash::key_of_t<K>;
+		std::array<key_t, N> array{};
+		for (size_t i = 0; i < N; ++i)
+			array[i] = key_t(keys[i]);
+		return perfect_set<key_t, N>(array);
+	}
+
+	// makes a perfect_set of strings, which ignores case (English-only: A-Z)
+	template <typename K, size_t N>
+	constexpr auto make_perfect_set_no_case(const K (&keys)[N])
+	{
+		using key_t = details::perfect_hash::key_of_t<K>;
+		static_assert(details::perfect_hash::is_string_key<key_t>::value, "make_perfect_set_no_case() requires string keys");
+		std::array<key_t, N> array{};
+		for (size_t i = 0; i < N; ++i)
+			array[i] = key_t(keys[i]);
+		return perfect_set<key_t, N, case_sensitivity::no_case>(array);
+	}
+
+	// isoneof(value, set) tests whether the value is in the perfect_set
+	template <typename T, typename K, size_t N, case_sensitivity sensitivity>
+	constexpr bool isoneof(const T & value, const perfect_set<K, N, sensitivity> & set) { return set.contains(value); }
+
+}
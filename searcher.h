@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// searcher<T>
+//
+//	A needle which is preprocessed once, so that it can be searched for efficiently in any number of texts
+//	(use tbx::find() and tbx::reverse_find() for one-off searches)
+//
+//	usage:
+//		const tbx::searcher<char> keyword("needle");			// or ("needle", tbx::case_sensitivity::no_case)
+//		for (const auto & document : documents)
+//			if (auto found = keyword.find(document))
+//				...
+//
+//	Short needles use the same vectorized filter as tbx::find() (only comparing the whole needle where its
+//	first and last characters both match).  Longer needles, and all case insensitive ones, use the Two-Way
+//	algorithm (Crochemore & Perrin), which skips ahead using a Horspool bad-character table.  So we're
+//	typically sublinear on long needles, and never worse than linear time, whatever the needle or the text.
+//
+//	Searches of character arrays stop at the first null (as with tbx::find()), whereas string types and
+//	string views are searched in their entirety.
+//
+//	NOTE! case insensitivity is English-only (A-Z), as with compare_no_case()
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <typename T>
+	class searcher
+	{
+	public:
+		// case sensitive needles up to this length use the vectorized filter
+		static constexpr size_t kShortNeedle = 16;
+
+		searcher(const T * needle, size_t length, case_sensitivity sensitivity = case_sensitivity::sensitive) :
+			m_no_case(sensitivity == case_sensitivity::no_case),
+			m_filter(!m_no_case && length <= kShortNeedle)
+		{
+			std::basic_string<T> folded(needle, length);
+			if (m_no_case)
+				for (auto & c : folded)
+					c = az_lower(c);
+
+			if (m_filter)
+			{
+				m_forward.needle = std::move(folded);
+			}
+			else
+			{
+				m_reverse = make_plan(std::basic_string<T>(folded.rbegin(), folded.rend()));
+				m_forward = make_plan(std::move(folded));
+			}
+		}
+
+		searcher(std::basic_string_view<T> needle, case_sensitivity sensitivity = case_sensitivity::sensitive) : searcher(needle.data(), needle.size(), sensitivity) {}
+
+		// the length of the needle
+		size_t length() const { return m_forward.needle.size(); }
+
+		// is this a case insensitive search?
+		bool is_no_case() const { return m_no_case; }
+
+		// returns the first occurrence of the needle in psz[0..size) (stopping at a null), or nullptr
+		// an empty needle matches at the start
+		const T * find(const T * psz, size_t size) const { return search(psz, GetLength(psz, size)); }
+
+		template <size_t size>
+		const T * find(const T(&psz)[size]) const { return find(psz, size); }
+
+		const T * find(std::basic_string_view<T> text) const { return search(text.data(), text.size()); }
+
+		// returns the last occurrence of the needle in psz[0..size) (stopping at a null), or nullptr
+		// an empty needle matches at the end
+		const T * reverse_find(const T * psz, size_t size) const { return reverse_search(psz, GetLength(psz, size)); }
+
+		template <size_t size>
+		const T * reverse_find(const T(&psz)[size]) const { return reverse_find(psz, size); }
+
+		const T * reverse_find(std::basic_string_view<T> text) const { return reverse_search(text.data(), text.size()); }
+
+	private:
+
+		static constexpr size_t npos = ~size_t(0);
+
+		// a needle, preprocessed for the Two-Way algorithm
+		struct plan
+		{
+			std::basic_string<T>		needle;				// folded to lowercase if no_case (and reversed, for reverse searches)
+			size_t						critical = 0;		// the critical factorization: needle = left[0..critical) + right[critical..)
+			size_t						period = 0;			// the needle's period if periodic, else how far to skip after a match of the right half
+			bool						periodic = false;	// is the left half a suffix of the right half's first period?
+			std::array<size_t, 256>		shift;				// bad-character shift (by the low byte of the character at the end of the window)
+		};
+
+		bool	m_no_case;
+		bool	m_filter;
+		plan	m_forward;
+		plan	m_reverse;
+
+		static size_t bucket(T c) { return static_cast<std::make_unsigned_t<T>>(c) & 0xFF; }
+
+		// returns the start of the critical factorization, and the period of the right half
+		// (the later of the maximal suffixes for the two orderings of the alphabet)
+		static size_t critical_factorization(const std::basic_string<T> & needle, size_t & period)
+		{
+			const auto m = needle.size();
+
+			// maximal suffix (ordered by <) and its period
+			// NOTE: suffixes start at index + 1, with ~0 (npos) for the whole needle
+			auto maximal_suffix = [&](bool reversed, size_t & local_period) {
+				size_t suffix = npos;
+				size_t j = 0, k = 1;
+				local_period = 1;
+				while (j + k < m)
+				{
+					const auto a = needle[j + k];
+					const auto b = needle[suffix + k];
+					if (reversed ? b < a : a < b)
+					{
+						j += k;
+						k = 1;
+						local_period = j - suffix;
+					}
+					else if (a == b)
+					{
+						if (k != local_period)
+							++k;
+						else
+						{
+							j += local_period;
+							k = 1;
+						}
+					}
+					else
+					{
+						suffix = j++;
+						k = local_period = 1;
+					}
+				}
+				return suffix + 1;
+			};
+
+			size_t forward_period, reverse_period;
+			const auto forward = maximal_suffix(false, forward_period);
+			const auto reverse = maximal_suffix(true, reverse_period);
+			if (reverse < forward)
+			{
+				period = forward_period;
+				return forward;
+			}
+			period = reverse_period;
+			return reverse;
+		}
+
+		static plan make_plan(std::basic_string<T> needle)
+		{
+			plan p;
+			p.needle = std::move(needle);
+			const auto m = p.needle.size();
+			if (!m)
+				return p;
+
+			p.critical = critical_factorization(p.needle, p.period);
+			p.periodic = std::equal(p.needle.begin(), p.needle.begin() + p.critical, p.needle.begin() + p.period);
+			if (!p.periodic)
+				p.period = std::max(p.critical, m - p.critical) + 1;
+
+			p.shift.fill(m);
+			for (size_t i = 0; i < m; ++i)
+				p.shift[bucket(p.needle[i])] = m - 1 - i;
+			return p;
+		}
+
+		// returns the index of the first match in the n characters given by at(0..n), or npos (requires 0 < needle length <= n)
+		// at() returns the (folded) character at the given index
+		template <typename at_t>
+		static size_t two_way(const plan & p, size_t n, at_t at)
+		{
+			const auto & needle = p.needle;
+			const auto m = needle.size();
+			const auto critical = p.critical;
+
+			// how much of the left of the needle is known to match already (periodic needles only)
+			size_t memory = 0;
+
+			for (size_t j = 0; j <= n - m; )
+			{
+				// skip ahead if the character at the end of the window is (or may be) elsewhere in the needle, or not at all
+				if (const auto shift = p.shift[bucket(at(j + m - 1))])
+				{
+					// if the last window matched, then nothing can match until the window has passed the character that broke the period
+					j += memory ? std::max(shift, m - p.period) : shift;
+					memory = 0;
+					continue;
+				}
+
+				// match the right half, left to right
+				auto i = std::max(critical, memory);
+				while (i < m && needle[i] == at(j + i))
+					++i;
+				if (i < m)
+				{
+					j += i - critical + 1;
+					memory = 0;
+					continue;
+				}
+
+				// then the left half, right to left
+				i = critical;
+				while (i > memory && needle[i - 1] == at(j + i - 1))
+					--i;
+				if (i <= memory)
+					return j;
+
+				j += p.period;
+				memory = p.periodic ? m - p.period : 0;
+			}
+			return npos;
+		}
+
+		const T * search(const T * psz, size_t n) const
+		{
+			const auto m = length();
+			if (!m)
+				return psz;
+			if (m > n)
+				return nullptr;
+			if (m_filter)
+				return details::simd::search(psz, n, m_forward.needle.data(), m);
+
+			const auto i = m_no_case ?
+				two_way(m_forward, n, [psz](size_t i) { return az_lower(psz[i]); }) :
+				two_way(m_forward, n, [psz](size_t i) { return psz[i]; });
+			return i == npos ? nullptr : psz + i;
+		}
+
+		const T * reverse_search(const T * psz, size_t n) const
+		{
+			const auto m = length();
+			if (!m)
+				return psz + n;
+			if (m > n)
+				return nullptr;
+			if (m_filter)
+				return details::simd::reverse_search(psz, n, m_forward.needle.data(), m);
+
+			// search the reversed text for the reversed needle
+			const auto last = psz + n - 1;
+			const auto i = m_no_case ?
+				two_way(m_reverse, n, [last](size_t i) { return az_lower(*(last - i)); }) :
+				two_way(m_reverse, n, [last](size_t i) { return *(last - i); });
+			return i == npos ? nullptr : psz + (n - i - m);
+		}
+	};
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define TBX_STRING_BUILDER_IOVEC
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// string_builder
+//
+//	Accumulates a (potentially very large) string in a list of chunks, so it never reallocates or moves
+//	what has already been written
+//
+//	usage:
+//		tbx::string_builder response;
+//		response += "HTTP/1.1 200 OK\r\n";
+//		response.append(body);
+//		std::copy(first, last, make_string_back_inserter(response));
+//		writev(fd, response.iovecs().data(), ...);		// or send each of response.segments()
+//		auto whole = response.str();					// one exact sized allocation
+//
+//	Appending a character is a bounds check and a store, and appending a run of characters is a bounds
+//	check and a memcpy (or two, if it spans chunks).  Chunks start small and double in size (up to
+//	kMaxChunk), so a builder of n characters has O(log n) chunks until it gets large, and never wastes
+//	more than a chunk's worth of space.
+//
+//	The builder is an acceptable target for make_string_back_inserter() and std::back_inserter().
+//	clear() keeps the first chunk for reuse.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	template <typename T>
+	class basic_string_builder
+	{
+	public:
+		using value_type = T;
+		using traits_type = std::char_traits<T>;
+		using view_type = std::basic_string_view<T>;
+
+		// chunk capacities (in characters)
+		static constexpr size_t kFirstChunk = 1024;
+		static constexpr size_t kMaxChunk = 1024 * 1024;
+
+		basic_string_builder() = default;
+		basic_string_builder(basic_string_builder && rhs) = default;
+		basic_string_builder & operator = (basic_string_builder && rhs) = default;
+
+		// (copying a builder is almost certainly a mistake - copy its str() instead)
+		basic_string_builder(const basic_string_builder &) = delete;
+		basic_string_builder & operator = (const basic_string_builder &) = delete;
+
+		// state
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		// discards the content (keeping the first chunk)
+		void clear()
+		{
+			if (m_chunks.size() > 1)
+				m_chunks.resize(1);
+			if (!m_chunks.empty())
+				m_chunks[0].length = 0;
+			m_size = 0;
+		}
+
+		// appending
+		void push_back(T c)
+		{
+			if (m_chunks.empty() || m_chunks.back().length == m_chunks.back().capacity)
+				grow(1);
+			auto & chunk = m_chunks.back();
+			chunk.data[chunk.length++] = c;
+			++m_size;
+		}
+
+		basic_string_builder & append(const T * text, size_t length)
+		{
+			m_size += length;
+			while (length)
+			{
+				if (m_chunks.empty() || m_chunks.back().length == m_chunks.back().capacity)
+					grow(length);
+				auto & chunk = m_chunks.back();
+				const auto count = std::min(length, chunk.capacity - chunk.length);
+				std::memcpy(chunk.data.get() + chunk.length, text, count * sizeof(T));
+				chunk.length += count;
+				text += count;
+				length -= count;
+			}
+			return *this;
+		}
+
+		basic_string_builder & append(view_type text) { return append(text.data(), text.size()); }
+		basic_string_builder & append(const T * psz) { return psz ? append(psz, traits_type::length(psz)) : *this; }
+		basic_string_builder & append(size_t count, T c)
+		{
+			while (count--)
+				push_back(c);
+			return *this;
+		}
+
+		basic_string_builder & operator += (T c) { push_back(c); return *this; }
+		basic_string_builder & operator += (const T * psz) { return append(psz); }
+		basic_string_builder & operator += (view_type text) { return append(text); }
+		basic_string_builder & operator += (const std::basic_string<T> & text) { return append(text.data(), text.size()); }
+
+		// output
+
+		// calls f(view) for each chunk, in order
+		template <typename F>
+		void for_each_segment(F && f) const
+		{
+			for (const auto & chunk : m_chunks)
+				if (chunk.length)
+					f(view_type(chunk.data.get(), chunk.length));
+		}
+
+		// views of each chunk, in order
+		std::vector<view_type> segments() const
+		{
+			std::vector<view_type> views;
+			views.reserve(m_chunks.size());
+			for_each_segment([&views](view_type view) { views.push_back(view); });
+			return views;
+		}
+
+#ifdef TBX_STRING_BUILDER_IOVEC
+		// scatter-gather buffers for writev() and friends
+		std::vector<iovec> iovecs() const
+		{
+			std::vector<iovec> buffers;
+			buffers.reserve(m_chunks.size());
+			for_each_segment([&buffers](view_type view) { buffers.push_back({ const_cast<T *>(view.data()), view.size() * sizeof(T) }); });
+			return buffers;
+		}
+#endif
+
+		// copies the content to the output iterator
+		template <typename output_iterator_t>
+		output_iterator_t copy(output_iterator_t out) const
+		{
+			for_each_segment([&out](view_type view) { out = std::copy(view.begin(), view.end(), out); });
+			return out;
+		}
+
+		// the content as one string (with one allocation, of exactly the right size)
+		std::basic_string<T> str() const
+		{
+			std::basic_string<T> result(m_size, T());
+			copy(&result[0]);
+			return result;
+		}
+
+	private:
+
+		struct chunk
+		{
+			std::unique_ptr<T[]>	data;
+			size_t					capacity;
+			size_t					length;
+		};
+
+		// adds a chunk (large enough for at least the given length, up to kMaxChunk)
+		void grow(size_t length)
+		{
+			const auto capacity = m_chunks.empty() ? kFirstChunk : std::min(m_chunks.back().capacity * 2, kMaxChunk);
+			const auto size = std::max(capacity, std::min(length, kMaxChunk));
+			m_chunks.push_back({ std::unique_ptr<T[]>(new T[size]), size, 0 });
+		}
+
+		std::vector<chunk>	m_chunks;
+		size_t				m_size = 0;
+	};
+
+	using string_builder = basic_string_builder<char>;
+	using wstring_builder = basic_string_builder<wchar_t>;
+
+}
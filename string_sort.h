@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "strings.h"
+
+//////////////////////////////////////////////////////////////////////////
+// sort_strings(first, last, sensitivity)
+//
+//	Sorts strings by their characters rather than by comparing them: an MSD radix sort (for narrow strings)
+//	which hands smaller buckets to a multikey quicksort, which hands the smallest to an insertion sort
+//
+//	usage:
+//		tbx::sort_strings(names.begin(), names.end());								// as compare() orders them
+//		tbx::sort_strings(headers.begin(), headers.end(), tbx::case_sensitivity::no_case);	// as compare_no_case() does
+//
+//	The strings may be std::basic_string, basic_string_view or const T * (for any character type), and
+//	the order is exactly that of compare() (or compare_no_case(), which folds A-Z to uppercase), with a
+//	shorter string before any which it's a prefix of.  Like std::sort(), it's not stable.
+//
+//	Each pass of the radix sort looks at one character (at the same depth) of each string, once, caching
+//	it while the strings are distributed into 257 buckets (one per character, and one for strings which
+//	have ended).  Each bucket then sorts by the next character, and so on, so no string's prefix is ever
+//	examined twice.  The multikey quicksort partitions by the character at the current depth (into less,
+//	equal and greater), so it too only moves on to the next character once the prefixes are equal.  The
+//	buckets and partitions still to be sorted are kept on a stack of their own (not by recursion), so very
+//	long strings, or long shared prefixes, can't overflow the thread's stack.
+//	The strings are sorted as views, and then the elements are moved into their places once.
+//////////////////////////////////////////////////////////////////////////
+
+namespace tbx {
+
+	namespace details {
+
+		namespace string_sort {
+
+			// views of string-like elements
+			template <typename T> std::basic_string_view<T> view_of(const std::basic_string<T> & s) { return s; }
+			template <typename T> std::basic_string_view<T> view_of(std::basic_string_view<T> s) { return s; }
+			template <typename T> std::basic_string_view<T> view_of(const T * s) { return StringOrBlank(s); }
+
+			// below this many strings, a bucket is sorted by multikey quicksort rather than another radix pass
+			constexpr size_t kRadixMinimum = 1024;
+
+			// and below this many, by insertion sort
+			constexpr size_t kInsertionMaximum = 16;
+
+			template <typename T>
+			struct record
+			{
+				const T *	data;
+				size_t		length;
+				size_t		index;		// of the element
+			};
+
+			template <typename T, bool no_case>
+			struct order
+			{
+				using U = std::make_unsigned_t<T>;
+				using key_t = std::conditional_t<(sizeof(T) < sizeof(uint32_t)), uint32_t, uint64_t>;
+
+				// compare_no_case() compares (uppercase) characters as T, and compare() as its char_traits do:
+				// as unsigned for char, and as T otherwise (and wchar_t is signed on some platforms)
+				static constexpr bool kSigned = std::is_signed_v<T> && (no_case || !std::is_same_v<T, char>);
+				static constexpr U kSignBit = kSigned ? U(U(1) << (8 * sizeof(T) - 1)) : U(0);
+
+				// the character at depth, as a value which orders as the comparison does, plus one (so 0 is the end of the string)
+				static key_t key(const record<T> & r, size_t depth)
+				{
+					if (depth >= r.length)
+						return 0;
+					const auto ch = no_case ? az_upper(r.data[depth]) : r.data[depth];
+					return key_t(U(U(ch) ^ kSignBit)) + 1;
+				}
+
+				// whether a < b, given that their first depth characters are equal
+				static bool less(const record<T> & a, const record<T> & b, size_t depth)
+				{
+					const std::basic_string_view<T> rest_a(a.data + depth, a.length - depth), rest_b(b.data + depth, b.length - depth);
+					return (no_case ? compare_no_case(rest_a, rest_b) : compare(rest_a, rest_b)) < 0;
+				}
+			};
+
+			template <typename T, bool no_case>
+			void insertion_sort(record<T> * a, size_t n, size_t depth)
+			{
+				for (size_t i = 1; i < n; ++i)
+				{
+					const auto r = a[i];
+					auto j = i;
+					for (; j && order<T, no_case>::less(r, a[j - 1], depth); --j)
+						a[j] = a[j - 1];
+					a[j] = r;
+				}
+			}
+
+			// returns the length of the prefix which all n strings share, given that they share the first depth characters
+			template <typename T, bool no_case>
+			size_t common_prefix(const record<T> * a, size_t n, size_t depth)
+			{
+				auto length = a[0].length;
+				for (size_t i = 1; i < n && length > depth; ++i)
+				{
+					const auto limit = std::min(length, a[i].length) - depth;
+					const auto p = a[0].data + depth, q = a[i].data + depth;
+					length = depth + (no_case ? details::simd::mismatch_no_case(p, q, limit) : size_t(std::mismatch(p, p + limit, q).first - p));
+				}
+				return length;
+			}
+
+			// sorts records with an explicit stack of the buckets and partitions still to be sorted (rather than by
+			// recursion, which would go a level deeper for each character)
+			template <typename T, bool no_case>
+			class sorter
+			{
+				using order_t = order<T, no_case>;
+
+				// the records [first, first + n), which share their first depth characters
+				struct range
+				{
+					size_t	first;
+					size_t	n;
+					size_t	depth;
+				};
+
+			public:
+				sorter(record<T> * records, size_t n) : m_records(records)
+				{
+					if constexpr (sizeof(T) == 1)
+					{
+						if (n >= kRadixMinimum)
+						{
+							m_temp.resize(n);
+							m_keys.resize(n);
+							m_counts.resize(257);
+							m_positions.resize(257);
+						}
+					}
+					push({ 0, n, 0 });
+				}
+
+				void sort()
+				{
+					while (!m_pending.empty())
+					{
+						const auto r = m_pending.back();
+						m_pending.pop_back();
+						if constexpr (sizeof(T) == 1)
+						{
+							if (r.n >= kRadixMinimum)
+							{
+								radix_pass(r);
+								continue;
+							}
+						}
+						multikey_pass(r);
+					}
+				}
+
+			private:
+
+				void push(const range & r)
+				{
+					if (r.n <= kInsertionMaximum)
+						insertion_sort<T, no_case>(m_records + r.first, r.n, r.depth);
+					else
+						m_pending.push_back(r);
+				}
+
+				// distributes the records into 257 buckets by the character at depth, or skips a prefix they all share
+				// (narrow strings only)
+				void radix_pass(range r)
+				{
+					const auto a = m_records + r.first;
+					const auto keys = m_keys.data() + r.first;
+					const auto counts = m_counts.data();
+					const auto positions = m_positions.data();
+					for (;;)
+					{
+						std::fill(counts, counts + 257, size_t(0));
+						for (size_t i = 0; i < r.n; ++i)
+							++counts[keys[i] = uint16_t(order_t::key(a[i], r.depth))];
+
+						// when they all have the same character, skip to the end of their common prefix, in one pass (or they've all ended, and are equal)
+						if (counts[keys[0]] != r.n)
+							break;
+						if (!keys[0])
+							return;
+						r.depth = common_prefix<T, no_case>(a, r.n, r.depth + 1);
+					}
+
+					size_t start = 0;
+					for (size_t bucket = 0; bucket < 257; ++bucket)
+					{
+						positions[bucket] = start;
+						start += counts[bucket];
+					}
+					const auto temp = m_temp.data() + r.first;
+					for (size_t i = 0; i < r.n; ++i)
+						temp[positions[keys[i]]++] = a[i];
+					std::copy(temp, temp + r.n, a);
+
+					// (bucket 0 has the strings which have ended, which are equal; and each position is now the end of its bucket)
+					for (size_t bucket = 1; bucket < 257; ++bucket)
+						if (counts[bucket] > 1)
+							push({ r.first + positions[bucket] - counts[bucket], counts[bucket], r.depth + 1 });
+				}
+
+				// partitions the records by the character at depth, into less, equal and greater (multikey quicksort)
+				void multikey_pass(range r)
+				{
+					while (r.n > kInsertionMaximum)
+					{
+						const auto a = m_records + r.first;
+
+						// the median of three as the pivot
+						auto x = order_t::key(a[0], r.depth), y = order_t::key(a[r.n / 2], r.depth), z = order_t::key(a[r.n - 1], r.depth);
+						if (x > y)
+							std::swap(x, y);
+						const auto pivot = std::max(x, std::min(y, z));
+
+						// partition into [0, lt) less, [lt, gt) equal and [gt, n) greater
+						size_t lt = 0, i = 0, gt = r.n;
+						while (i < gt)
+						{
+							const auto key = order_t::key(a[i], r.depth);
+							if (key < pivot)
+								std::swap(a[lt++], a[i++]);
+							else if (key > pivot)
+								std::swap(a[i], a[--gt]);
+							else
+								++i;
+						}
+
+						// when they're all equal, skip to the end of their common prefix (or they've all ended, and are equal)
+						if (lt == 0 && gt == r.n)
+						{
+							if (!pivot)
+								return;
+							r.depth = common_prefix<T, no_case>(a, r.n, r.depth + 1);
+							continue;
+						}
+
+						// otherwise the equal ones go on to the next character, and less and greater stay at this one
+						if (pivot)
+							push({ r.first + lt, gt - lt, r.depth + 1 });
+						push({ r.first, lt, r.depth });
+						r = { r.first + gt, r.n - gt, r.depth };
+					}
+					insertion_sort<T, no_case>(m_records + r.first, r.n, r.depth);
+				}
+
+				record<T> *					m_records;
+				std::vector<range>			m_pending;
+				std::vector<record<T>>		m_temp;			// (the radix passes')
+				std::vector<uint16_t>		m_keys;			// the key of each record, in the current radix pass
+				std::vector<size_t>			m_counts;		// of each bucket, in the current radix pass
+				std::vector<size_t>			m_positions;	// the next free place in each bucket
+			};
+
+			template <typename T, bool no_case>
+			void sort(record<T> * a, size_t n)
+			{
+				sorter<T, no_case>(a, n).sort();
+			}
+
+			template <bool no_case, typename iterator_t>
+			void sort_elements(iterator_t first, iterator_t last)
+			{
+				using T = typename decltype(view_of(*first))::value_type;
+				using value_t = typename std::iterator_traits<iterator_t>::value_type;
+
+				const auto size = size_t(last - first);
+				std::vector<record<T>> records(size);
+				for (size_t i = 0; i < size; ++i)
+				{
+					const auto view = view_of(first[i]);
+					records[i] = { view.data(), view.size(), i };
+				}
+
+				sort<T, no_case>(records.data(), size);
+
+				// then put the elements in the order of their records
+				std::vector<value_t> sorted;
+				sorted.reserve(size);
+				for (const auto & r : records)
+					sorted.push_back(std::move(first[r.index]));
+				std::move(sorted.begin(), sorted.end(), first);
+			}
+
+		}
+
+	}
+
+	// sorts [first, last) of strings (std::basic_string, basic_string_view or const T *), as compare() or compare_no_case() orders them
+	template <typename iterator_t>
+	void sort_strings(iterator_t first, iterator_t last, case_sensitivity sensitivity = case_sensitivity::sensitive)
+	{
+		if (sensitivity == case_sensitivity::no_case)
+			details::string_sort::sort_elements<true>(first, last);
+		else
+			details::string_sort::sort_elements<false>(first, last);
+	}
+
+}
@@ -12,20 +12,28 @@ namespace tbx {
 		va_list args;
 		va_start(args, format);
 
-		std::string str;
+		// vsnprintf consumes its va_list, so keep a copy for a second attempt
+		va_list retry;
+		va_copy(retry, args);
 
-		// attempt using a default buffer
-		AutoStrBuffer buff(str, 63);
-		auto required_length = std::vsnprintf(buff.get(), buff.size(), format, args);
-		if (required_length > buff.length())
+		std::string str;
 		{
-			// reattempt using a larger buffer
-			buff.resize(required_length);
-			TBX_VERIFY(std::vsnprintf(buff.get(), buff.size(), format, args) == required_length);
+			// attempt using a default buffer
+			AutoStrBuffer buff(str, 63);
+			auto required_length = std::vsnprintf(buff.get(), buff.size(), format, args);
+			if (required_length > buff.length())
+			{
+				// reattempt using a larger buffer
+				buff.resize(required_length);
+				TBX_VERIFY(std::vsnprintf(buff.get(), buff.size(), format, retry) == required_length);
+			}
 		}
 
-		// subtle: we're returning str, which will be set to contain the real value because it will be 
-		//         moved out of buff when ~buff(), before moving str to caller
+		va_end(retry);
+		va_end(args);
+
+		// subtle: str holds the real value because buff moved it back into str at the end of the block above
+		//         (the block ensures that ~buff() runs before we return str to the caller)
 		return str;
 	}
 
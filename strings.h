@@ -2,7 +2,11 @@
 
 #include <algorithm> 
 #include <cctype>
+#include <iterator>
 #include <locale>
+#include <string_view>
+#include "char_class.h"
+#include "strings_simd.h"
 
 //////////////////////////////////////////////////////////////////////////
 // Character & String primitives
@@ -37,6 +41,9 @@ namespace tbx {
 	inline bool is_eq(strcmpcode strcmp_result) { return strcmp_result == 0; }
 	inline bool is_gt(strcmpcode strcmp_result) { return strcmp_result >= 1; }
 
+	// whether searches and comparisons distinguish case (or fold A-Z to a-z, as compare_no_case() does)
+	enum class case_sensitivity { sensitive, no_case };
+
 	// internal backwards compatibility shims
 	// TODO: remove these!
 #define STRCMP_LESS(strcmp_result) is_lt(strcmp_result)
@@ -95,26 +102,61 @@ namespace tbx {
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// English-only character classification (q.v. classic locale)
+	// English-only character classification (q.v. classic locale, and char_class.h)
 
 	template <typename T>
-	bool is_control(const T & ch) { return ch < 0x20 || ch == 0x7F; }
+	constexpr bool is_control(const T & ch) { return has_char_class(ch, char_class::control); }
 	template <typename T>
-	bool is_printable(const T & ch) { return !is_control(ch); }
+	constexpr bool is_printable(const T & ch) { return has_char_class(ch, char_class::printable); }
 	template <typename T>
-	bool is_whitespace(const T & ch) { return ch == 0x20 || (ch >= 0x09 && ch <= 0x0D); }
+	constexpr bool is_whitespace(const T & ch) { return has_char_class(ch, char_class::whitespace); }
 	template <typename T>
-	bool is_lowercase(const T & ch) { return ch >= LITERAL(T, 'a') && ch <= LITERAL(T, 'z'); }
+	constexpr bool is_lowercase(const T & ch) { return has_char_class(ch, char_class::lowercase); }
 	template <typename T>
-	bool is_uppercase(const T & ch) { return ch >= LITERAL(T, 'A') && ch <= LITERAL(T, 'Z'); }
+	constexpr bool is_uppercase(const T & ch) { return has_char_class(ch, char_class::uppercase); }
 	template <typename T>
-	bool is_alphabetical(const T & ch) { return is_lowercase(ch) || is_uppercase(ch); }
+	constexpr bool is_alphabetical(const T & ch) { return has_char_class(ch, char_class::alphabetical); }
 	template <typename T>
-	bool is_digit(const T & ch) { return ch >= LITERAL(T, '0') && ch <= LITERAL(T, '9'); }
+	constexpr bool is_digit(const T & ch) { return has_char_class(ch, char_class::digit); }
 	template <typename T>
-	bool is_alphanumeric(const T & ch) { return is_alphabetical(ch) || is_digit(ch); }
+	constexpr bool is_alphanumeric(const T & ch) { return has_char_class(ch, char_class::alphanumeric); }
 	template <typename T>
-	bool is_hex_digit(const T & ch) { return is_digit(ch) || (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f'); }
+	constexpr bool is_hex_digit(const T & ch) { return has_char_class(ch, char_class::hex_digit); }
+
+	//////////////////////////////////////////////////////////////////////////
+	// bulk classification
+
+	// returns the first character in psz[0..length) which is in any of the given classes, or nullptr
+	template <typename T>
+	T * find_first_of_class(T * psz, size_t length, char_classes classes) {
+		const auto i = details::simd::find_class<std::remove_const_t<T>>(psz, length, classes, true);
+		return i == length ? nullptr : psz + i;
+	}
+
+	// returns the first character in psz[0..length) which isn't in any of the given classes, or nullptr
+	template <typename T>
+	T * find_first_not_of_class(T * psz, size_t length, char_classes classes) {
+		const auto i = details::simd::find_class<std::remove_const_t<T>>(psz, length, classes, false);
+		return i == length ? nullptr : psz + i;
+	}
+
+	// returns the last character in psz[0..length) which is in any of the given classes, or nullptr
+	template <typename T>
+	T * find_last_of_class(T * psz, size_t length, char_classes classes) {
+		const auto i = details::simd::reverse_find_class<std::remove_const_t<T>>(psz, length, classes, true);
+		return i == length ? nullptr : psz + i;
+	}
+
+	// returns the last character in psz[0..length) which isn't in any of the given classes, or nullptr
+	template <typename T>
+	T * find_last_not_of_class(T * psz, size_t length, char_classes classes) {
+		const auto i = details::simd::reverse_find_class<std::remove_const_t<T>>(psz, length, classes, false);
+		return i == length ? nullptr : psz + i;
+	}
+
+	// returns the number of characters in psz[0..length) which are in any of the given classes
+	template <typename T>
+	size_t count_class(const T * psz, size_t length, char_classes classes) { return details::simd::count_class(psz, length, classes); }
 
 	//////////////////////////////////////////////////////////////////////////
 	// English-only case manipulation
@@ -175,15 +217,10 @@ namespace tbx {
 		typename std::enable_if_t<is_character_v<T>, int> = 0
 	>
 	auto GetLength(const T * psz, size_t size) {
-		size_t l = 0;
-		if (psz && size)
-			while (*psz)
-			{
-				if (++l == size)
-					break;
-				++psz;
-			}
-		return l;
+		if (!psz || !size)
+			return size_t(0);
+		const auto terminator = details::simd::find(psz, size, T(0));
+		return terminator ? size_t(terminator - psz) : size;
 	}
 
 	// return the length of the string with known size (upper bounds)
@@ -240,34 +277,52 @@ namespace tbx {
 	strcmpcode compare(const T * first, const T * second) {
 		const auto l1 = GetLength(first);
 		const auto l2 = GetLength(second);
-		auto result = compare(first, second, min(l1, l2));
+		auto result = compare(first, second, std::min(l1, l2));
 		return result ? result : l1 < l2 ? -1 : l1 > l2 ? +1 : 0;
 	}
 
+	// lexicographical comparison of views
+	template <typename T>
+	strcmpcode compare(std::basic_string_view<T> first, std::basic_string_view<T> second) {
+		return first.compare(second);
+	}
+
 	// case insensitive comparison
 	// NOTE! this function only really makes sense for strings that are in English
 	//       there are languages where case means something, but these functions aren't that sophisticated!
 	//		 for non-English strings, please use another library such as ICU: http://site.icu-project.org/
 	template <typename T>
 	strcmpcode compare_no_case(const T * first, const T * second, size_t length) {
-		while (length--)
-		{
-			auto ch1 = az_upper(*first);
-			auto ch2 = az_upper(*second);
-			if (ch1 != ch2)
-				return ch1 < ch2 ? -1 : +1;
-			++first;
-			++second;
-		}
-
-		return 0;
+		const auto i = details::simd::mismatch_no_case(first, second, length);
+		if (i == length)
+			return 0;
+		auto ch1 = az_upper(first[i]);
+		auto ch2 = az_upper(second[i]);
+		return ch1 < ch2 ? -1 : +1;
 	}
 
 	template <typename T>
 	strcmpcode compare_no_case(const T * first, const T * second) {
-		const auto l1 = GetLength(first);
-		const auto l2 = GetLength(second);
-		auto result = compare_no_case(first, second, min(l1, l2));
+		first = StringOrBlank(first);
+		second = StringOrBlank(second);
+
+		// a single pass, up to the first difference or the end of both (a shorter string is less)
+		const auto i = details::simd::mismatch_no_case(first, second);
+		if (!first[i])
+			return second[i] ? -1 : 0;
+		if (!second[i])
+			return +1;
+		auto ch1 = az_upper(first[i]);
+		auto ch2 = az_upper(second[i]);
+		return ch1 < ch2 ? -1 : +1;
+	}
+
+	// case insensitive comparison of views
+	template <typename T>
+	strcmpcode compare_no_case(std::basic_string_view<T> first, std::basic_string_view<T> second) {
+		const auto l1 = first.size();
+		const auto l2 = second.size();
+		auto result = compare_no_case(first.data(), second.data(), std::min(l1, l2));
 		return result ? result : l1 < l2 ? -1 : l1 > l2 ? +1 : 0;
 	}
 
@@ -328,12 +383,7 @@ namespace tbx {
 	//		 for non-English strings, please use another library such as ICU: http://site.icu-project.org/
 	template <typename T>
 	auto make_uppercase(T * dest, size_t maxlength) {
-		for (size_t i = 0; i < maxlength; ++i)
-		{
-			if (!dest[i])
-				break;
-			dest[i] = az_upper(dest[i]);
-		}
+		details::simd::convert_case<true>(dest, maxlength);
 		return dest;
 	}
 
@@ -346,12 +396,7 @@ namespace tbx {
 	//		 for non-English strings, please use another library such as ICU: http://site.icu-project.org/
 	template <typename T>
 	auto make_lowercase(T * dest, size_t maxlength) {
-		for (size_t i = 0; i < maxlength; ++i)
-		{
-			if (!dest[i])
-				break;
-			dest[i] = az_lower(dest[i]);
-		}
+		details::simd::convert_case<false>(dest, maxlength);
 		return dest;
 	}
 
@@ -361,8 +406,7 @@ namespace tbx {
 	// find character
 	template <typename T>
 	T * find(T * psz, size_t maxlength, T chr) {
-		using namespace std;
-		return char_traits<T>::find(psz, maxlength, chr);
+		return const_cast<T *>(details::simd::find<std::remove_const_t<T>>(psz, maxlength, chr));
 	}
 
 	template <typename T, size_t size>
@@ -371,10 +415,7 @@ namespace tbx {
 	// reverse find character
 	template <typename T>
 	T * reverse_find(T * psz, size_t length, T chr) {
-		while (length--)
-			if (psz[length] == chr)
-				return psz;
-		return nullptr;
+		return const_cast<T *>(details::simd::reverse_find<std::remove_const_t<T>>(psz, length, chr));
 	}
 
 	// search for substring
@@ -390,23 +431,8 @@ namespace tbx {
 		if (search_length == 0)
 			return psz;
 
-		// find first char
-		// check if it is a match on the rest
-		// repeat until exhausted for length(search)
-		const auto probe_end = psz + (target_length - search_length) + 1;
-		for (auto probe = psz; ; ++probe)
-		{
-			// find next occurrence of first search char
-			probe = find(probe, probe_end - probe, *search);
-
-			// if we can't find the start, then it isn't here
-			if (!probe)
-				return nullptr;
-
-			// check if we found match
-			if (is_eq(compare(probe, search, search_length)))
-				return probe;
-		}
+		// only probe where both the first and last search chars match
+		return const_cast<T *>(details::simd::search<std::remove_const_t<T>>(psz, target_length, search, search_length));
 	}
 
 	template <typename T>
@@ -431,22 +457,34 @@ namespace tbx {
 		if (search_length == 0)
 			return psz + target_length;
 
-		// rfind first char
-		// check if it is a match on the rest
-		// repeat until exhausted for length(search)
-		for (auto probe = psz + target_length - search_length; ; --probe)
-		{
-			// find next occurrence of first search char
-			auto probe = reverse_find(psz, probe - psz, *search);
+		// only probe where both the first and last search chars match (starting from the end)
+		return const_cast<T *>(details::simd::reverse_search<std::remove_const_t<T>>(psz, target_length, search, search_length));
+	}
 
-			// if we can't find the start, then it isn't here
-			if (!probe)
-				return nullptr;
+	// find in a view (all of it - views may contain nulls), returns nullptr if not found
+	template <typename T>
+	const T * find(std::basic_string_view<T> text, T chr) { return details::simd::find(text.data(), text.size(), chr); }
 
-			// check if we found match
-			if (is_eq(compare(probe, search, search_length)))
-				return probe;
-		}
+	template <typename T>
+	const T * find(std::basic_string_view<T> text, std::basic_string_view<T> search) {
+		if (search.size() > text.size())
+			return nullptr;
+		if (search.empty())
+			return text.data();
+		return details::simd::search(text.data(), text.size(), search.data(), search.size());
+	}
+
+	// reverse find in a view, returns nullptr if not found
+	template <typename T>
+	const T * reverse_find(std::basic_string_view<T> text, T chr) { return details::simd::reverse_find(text.data(), text.size(), chr); }
+
+	template <typename T>
+	const T * reverse_find(std::basic_string_view<T> text, std::basic_string_view<T> search) {
+		if (search.size() > text.size())
+			return nullptr;
+		if (search.empty())
+			return text.data() + text.size();
+		return details::simd::reverse_search(text.data(), text.size(), search.data(), search.size());
 	}
 
 #ifdef USE_LEGACY_FORMAT
@@ -497,19 +535,68 @@ namespace tbx {
 				throw std::range_error(context);
 			}
 		};
+
+		// ignore the overflow (fixed_string<> keeps as much as fits, back inserters drop the write)
+		struct truncate
+		{
+			static void handle_overflow(const char *) {}
+		};
 	}
 
-	template <typename T, size_t size, typename overflow_policy = overflow_policy::throw_range_error>
+	namespace termination_policy {
+		// null terminate the buffer after every write (so it's always safe to read)
+		struct immediate
+		{
+			static constexpr bool deferred = false;
+		};
+
+		// only null terminate the buffer on flush() or destruction (so appending is as fast as memcpy, but don't read the buffer until then)
+		struct on_flush
+		{
+			static constexpr bool deferred = true;
+		};
+	}
+
+	template <typename T, size_t size, typename overflow_policy = overflow_policy::throw_range_error, typename termination_policy = termination_policy::immediate>
 	struct fixed_character_back_insert_iterator
 	{
+		static_assert(size > 0, "fixed_character_back_insert_iterator<> requires room for a null terminator");
+
 		using char_t = T;
 		typedef T container_type[size];
 
-		// construct us on a fixed sized buffer
-		fixed_character_back_insert_iterator(container_type &sz) : m_sz(sz), m_length(Toolbox::SmartChar::get_length(sz)) {}
+		// the most characters we can hold (leaving room for the null terminator)
+		static constexpr size_t capacity = size - 1;
+
+		// construct us on a fixed sized buffer (appending to the string already there)
+		fixed_character_back_insert_iterator(container_type &sz) : m_sz(sz), m_length(std::min(GetLength(sz), capacity)) { m_sz[m_length] = 0; }
+
+		// copies share our buffer, which is terminated as we're copied (when deferred), so that only the iterators
+		// which have written to it since then will terminate it again (and one which is left behind, such as one
+		// passed by value to std::copy(), can't truncate what its copies wrote)
+		fixed_character_back_insert_iterator(const fixed_character_back_insert_iterator & rhs) : m_sz(rhs.m_sz), m_length(rhs.m_length) { rhs.flush(); }
+
+		~fixed_character_back_insert_iterator()
+		{
+			flush();
+		}
 
 		// nonstandard extension
-		bool full() const { return m_length == size; }
+		bool full() const { return m_length == capacity; }
+		size_t length() const { return m_length; }
+
+		// null terminates the buffer, if we've written to it since it was last terminated (only necessary when deferred)
+		void flush() const
+		{
+			if constexpr (termination_policy::deferred)
+			{
+				if (m_unterminated)
+				{
+					m_sz[m_length] = 0;
+					m_unterminated = false;
+				}
+			}
+		}
 
 		// what we actually do
 		fixed_character_back_insert_iterator & operator = (T c)
@@ -520,10 +607,8 @@ namespace tbx {
 			}
 			else
 			{
-				// we could optimize this by only setting the null marker upon deconstruction or similar, but that makes us much less safe...
-				// hopefully the compiler can optimize this double write to adjacent address reasonably well...
-				m_sz[m_length] = c;
-				m_sz[++m_length] = 0;
+				m_sz[m_length++] = c;
+				terminate();
 			}
 			return *this;
 		}
@@ -533,30 +618,80 @@ namespace tbx {
 		fixed_character_back_insert_iterator & operator ++ () { return *this; }
 		fixed_character_back_insert_iterator & operator ++ (int) { return *this; }
 
-		// efficiency extension: insert a whole run of characters...
-		fixed_character_back_insert_iterator & operator = (char_t * psz)
+		// efficiency extension: insert a whole run of characters (all or nothing)
+		fixed_character_back_insert_iterator & append(const char_t * text, size_t length)
 		{
-			// check if we have that much available (incl. null terminator)
-			const size_t length = Toolbox::SmartChar::get_length(psz) + 1;
-			if (length > size - m_length)
+			if (length > capacity - m_length)
+			{
 				overflow_policy::handle_overflow(__FUNCTION__);
+			}
 			else
 			{
-				Toolbox::SmartChar::copy_at(m_sz, m_length, psz, length);
+				std::memcpy(m_sz + m_length, text, length * sizeof(char_t));
 				m_length += length;
+				terminate();
 			}
 			return *this;
 		}
 
+		// insert a range of characters (all or nothing, unless they're only input iterators)
+		template <typename iterator_t>
+		fixed_character_back_insert_iterator & append(iterator_t first, iterator_t last)
+		{
+			using category = typename std::iterator_traits<iterator_t>::iterator_category;
+			if constexpr (std::is_pointer_v<iterator_t>)
+				return append(first, size_t(last - first));
+			else if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>)
+			{
+				const auto length = size_t(std::distance(first, last));
+				if (length > capacity - m_length)
+					overflow_policy::handle_overflow(__FUNCTION__);
+				else
+				{
+					std::copy(first, last, m_sz + m_length);
+					m_length += length;
+					terminate();
+				}
+				return *this;
+			}
+			else
+			{
+				for (; first != last; ++first)
+					*this = *first;
+				return *this;
+			}
+		}
+
+		fixed_character_back_insert_iterator & operator = (const char_t * psz) { return append(psz, GetLength(psz)); }
+		fixed_character_back_insert_iterator & operator = (std::basic_string_view<char_t> text) { return append(text.data(), text.size()); }
+
+		// any contiguous range of characters (std::basic_string, std::vector, std::array...)
+		template <
+			typename range_t,
+			typename std::enable_if_t<!std::is_array_v<range_t> && std::is_same_v<std::remove_cv_t<std::remove_pointer_t<decltype(std::data(std::declval<const range_t &>()))>>, char_t>, int> = 0
+		>
+		fixed_character_back_insert_iterator & operator = (const range_t & range) { return append(std::data(range), std::size(range)); }
+
 	private:
-		container_type &	m_sz;		// where we're accumulating our data
-		size_t				m_length;	// our current null terminator is here...
+
+		// after a write, either terminate the buffer or note that it needs it
+		void terminate()
+		{
+			if constexpr (termination_policy::deferred)
+				m_unterminated = true;
+			else
+				m_sz[m_length] = 0;
+		}
+
+		container_type &	m_sz;					// where we're accumulating our data
+		size_t				m_length;				// our current null terminator is here...
+		mutable bool		m_unterminated = false;	// (deferred termination only) we've written since we last terminated
 	};
 
-	template <typename char_t, size_t size, typename overflow_policy = overflow_policy::throw_range_error>
-	fixed_character_back_insert_iterator<char_t, size, overflow_policy> make_string_back_inserter(char_t(&str)[size])
+	template <typename char_t, size_t size, typename overflow_policy = overflow_policy::throw_range_error, typename termination_policy = termination_policy::immediate>
+	fixed_character_back_insert_iterator<char_t, size, overflow_policy, termination_policy> make_string_back_inserter(char_t(&str)[size])
 	{
-		return fixed_character_back_insert_iterator<char_t, size, overflow_policy>(str);
+		return fixed_character_back_insert_iterator<char_t, size, overflow_policy, termination_policy>(str);
 	}
 
 	// adapter to use a std::string for target of a back_insert_iterator (i.e. an output iterator)
@@ -594,34 +729,68 @@ namespace tbx {
 namespace tbx {
 
 	//////////////////////////////////////////////////////////////////////////
-	// whitespace trimming for any string-like entity that supports the necessary ops
+	// whitespace trimming of views (which merely narrows them - no copies, no allocations)
+
+	// trim from start
+	template <typename T>
+	std::basic_string_view<T> trim_left(std::basic_string_view<T> s) {
+		const auto first = find_first_not_of_class(s.data(), s.size(), char_class::whitespace);
+		return s.substr(first ? first - s.data() : s.size());
+	}
+
+	// trim from end
+	template <typename T>
+	std::basic_string_view<T> trim_right(std::basic_string_view<T> s) {
+		const auto last = find_last_not_of_class(s.data(), s.size(), char_class::whitespace);
+		return s.substr(0, last ? last - s.data() + 1 : 0);
+	}
+
+	// trim from both ends
+	template <typename T>
+	std::basic_string_view<T> trim(std::basic_string_view<T> s) { return trim_right(trim_left(s)); }
+
+	//////////////////////////////////////////////////////////////////////////
+	// whitespace trimming for any string-like entity that supports the necessary ops (in place)
+
+	namespace details {
+
+		// reduces s to the given view of it, moving its characters (if need be) and then erasing the excess just once
+		template <typename str_t, typename T>
+		void keep_only(str_t & s, std::basic_string_view<T> view) {
+			using namespace std;
+			const auto first = view.data() - data(s);
+			if (first)
+				std::copy(begin(s) + first, begin(s) + first + view.size(), begin(s));
+			if (view.size() != size(s))
+				s.erase(begin(s) + view.size(), end(s));
+		}
+
+		template <typename str_t>
+		auto view_of(str_t & s) {
+			using namespace std;
+			return basic_string_view<remove_const_t<remove_pointer_t<decltype(data(s))>>>(data(s), size(s));
+		}
+
+	}
 
 	// trim from start (in place)
 	template <typename str_t>
-	void trim_left(str_t & s) {
-		using namespace std;
-		s.erase(begin(s), find_if(begin(s), end(s), [](auto ch) { return !isspace(ch); }));
-	}
+	void trim_left(str_t & s) { details::keep_only(s, trim_left(details::view_of(s))); }
 
 	// trim from end (in place)
 	template <typename str_t>
-	void trim_right(str_t & s) {
-		using namespace std;
-		s.erase(find_if(rbegin(s), rend(s), [](auto ch) { return !isspace(ch); }).base(), end(s));
-	}
+	void trim_right(str_t & s) { details::keep_only(s, trim_right(details::view_of(s))); }
 
 	// trim from both ends (in place)
 	template <typename str_t>
-	void trim(str_t & s) {
-		trim_right(s);
-		trim_left(s);
-	}
+	void trim(str_t & s) { details::keep_only(s, trim(details::view_of(s))); }
 
 	//////////////////////////////////////////////////////////////////////////
 
 	//TODO: convert C language ... with template driven decoding
 
 	// printf style string formatting helpers
+	// NOTE: prefer tbx::format() (formatter.h), which is type safe, checked at compile time, and much faster
 	std::string format_string(const char * format, ...);
 
 }
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "char_class.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Vectorized character array primitives (used by strings.h)
+//
+//	These operate on bounded arrays of any character type (1, 2 or 4 bytes wide), and never read
+//	outside of the bounds they're given.  Where SSE2 is available (any x64 build, or x86 with
+//	/arch:SSE2 or better) they examine 16 bytes at a time, otherwise they fall back to simple loops.
+//
+//	The substring searches only compare the full needle at positions where both its first and its
+//	last characters match, which filters out nearly all false starts (even on very repetitive data).
+//
+//	The case folding kernels are English-only (A-Z), as is the rest of strings.h.  Those that work on
+//	null terminated strings do read whole vectors past the terminator, but never across a page boundary
+//	(as does every optimized strlen), so they're exempted from address sanitizing.
+//
+//	The class scanners test vectors of characters against the same ranges as char_class.h's table.
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TBX_SIMD_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TBX_NO_SANITIZE_ADDRESS __declspec(no_sanitize_address)
+#elif defined(__GNUC__) || defined(__clang__)
+#define TBX_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define TBX_NO_SANITIZE_ADDRESS
+#endif
+
+namespace tbx {
+
+	namespace details {
+
+		namespace simd {
+
+			// index of the lowest set bit (mask must be non-zero)
+			inline unsigned lowest_bit(uint32_t mask)
+			{
+#ifdef _MSC_VER
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return index;
+#else
+				return __builtin_ctz(mask);
+#endif
+			}
+
+			// index of the highest set bit (mask must be non-zero)
+			inline unsigned highest_bit(uint32_t mask)
+			{
+#ifdef _MSC_VER
+				unsigned long index;
+				_BitScanReverse(&index, mask);
+				return index;
+#else
+				return 31 - __builtin_clz(mask);
+#endif
+			}
+
+			// the number of set bits
+			inline unsigned bit_count(uint32_t mask)
+			{
+#ifdef _MSC_VER
+				mask = mask - ((mask >> 1) & 0x55555555);
+				mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+				return (((mask + (mask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+#else
+				return __builtin_popcount(mask);
+#endif
+			}
+
+#ifdef TBX_SIMD_SSE2
+
+			// per-width SSE2 operations
+			// match masks have one bit per character (the lowest bit of that character's bytes), so mask &= mask - 1 steps to the next character
+			template <size_t width> struct sse2;
+
+			template <> struct sse2<1>
+			{
+				template <typename T> static __m128i splat(T c) { return _mm_set1_epi8(static_cast<char>(c)); }
+				static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+				static __m128i greater(__m128i a, __m128i b) { return _mm_cmpgt_epi8(a, b); }
+				static __m128i less(__m128i a, __m128i b) { return _mm_cmplt_epi8(a, b); }
+				static constexpr uint32_t kMask = 0xFFFF;
+			};
+
+			template <> struct sse2<2>
+			{
+				template <typename T> static __m128i splat(T c) { return _mm_set1_epi16(static_cast<short>(c)); }
+				static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+				static __m128i greater(__m128i a, __m128i b) { return _mm_cmpgt_epi16(a, b); }
+				static __m128i less(__m128i a, __m128i b) { return _mm_cmplt_epi16(a, b); }
+				static constexpr uint32_t kMask = 0x5555;
+			};
+
+			template <> struct sse2<4>
+			{
+				template <typename T> static __m128i splat(T c) { return _mm_set1_epi32(static_cast<int>(c)); }
+				static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+				static __m128i greater(__m128i a, __m128i b) { return _mm_cmpgt_epi32(a, b); }
+				static __m128i less(__m128i a, __m128i b) { return _mm_cmplt_epi32(a, b); }
+				static constexpr uint32_t kMask = 0x1111;
+			};
+
+			template <typename T>
+			__m128i load(const T * p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+
+			template <typename T>
+			uint32_t to_mask(__m128i matches) { return static_cast<uint32_t>(_mm_movemask_epi8(matches)) & sse2<sizeof(T)>::kMask; }
+
+			// characters within [low, high] (signed comparisons, which is fine for ASCII ranges)
+			template <typename T>
+			__m128i in_range(__m128i x, int low, int high)
+			{
+				using ops = sse2<sizeof(T)>;
+				return _mm_and_si128(ops::greater(x, ops::splat(low - 1)), ops::less(x, ops::splat(high + 1)));
+			}
+
+			// A-Z -> a-z
+			template <typename T>
+			__m128i fold_lower(__m128i x) { return _mm_or_si128(x, _mm_and_si128(in_range<T>(x, 'A', 'Z'), sse2<sizeof(T)>::splat(0x20))); }
+
+			// a-z -> A-Z
+			template <typename T>
+			__m128i fold_upper(__m128i x) { return _mm_andnot_si128(_mm_and_si128(in_range<T>(x, 'a', 'z'), sse2<sizeof(T)>::splat(0x20)), x); }
+
+			// characters which are in any of the given classes
+			template <typename T>
+			__m128i class_matches(__m128i x, char_classes classes)
+			{
+				using ops = sse2<sizeof(T)>;
+				auto matches = _mm_setzero_si128();
+				if (classes & (char_class::control | char_class::printable))
+				{
+					const auto control = _mm_or_si128(in_range<T>(x, 0x00, 0x1F), ops::equal(x, ops::splat(0x7F)));
+					if (classes & char_class::control)
+						matches = _mm_or_si128(matches, control);
+					if (classes & char_class::printable)
+						matches = _mm_or_si128(matches, _mm_andnot_si128(control, _mm_set1_epi32(-1)));
+				}
+				if (classes & char_class::whitespace)
+					matches = _mm_or_si128(matches, _mm_or_si128(ops::equal(x, ops::splat(' ')), in_range<T>(x, 0x09, 0x0D)));
+				if (classes & char_class::lowercase)
+					matches = _mm_or_si128(matches, in_range<T>(x, 'a', 'z'));
+				if (classes & char_class::uppercase)
+					matches = _mm_or_si128(matches, in_range<T>(x, 'A', 'Z'));
+				if (classes & (char_class::digit | char_class::hex_digit))
+					matches = _mm_or_si128(matches, in_range<T>(x, '0', '9'));
+				if (classes & char_class::hex_digit)
+					matches = _mm_or_si128(matches, _mm_or_si128(in_range<T>(x, 'a', 'f'), in_range<T>(x, 'A', 'F')));
+				return matches;
+			}
+
+			// can we read 16 bytes from p without crossing into the next page? (and hence without faulting, given that p is readable)
+			inline bool within_page(const void * p)
+			{
+				constexpr uintptr_t kPageSize = 4096;
+				return (reinterpret_cast<uintptr_t>(p) & (kPageSize - 1)) <= kPageSize - 16;
+			}
+
+#endif
+
+			// A-Z -> a-z
+			template <typename T>
+			T fold_lower(T c) { return c >= T('A') && c <= T('Z') ? T(c | 0x20) : c; }
+
+			// a-z -> A-Z
+			template <typename T>
+			T fold_upper(T c) { return c >= T('a') && c <= T('z') ? T(c & ~0x20) : c; }
+
+			// returns the first occurrence of c in p[0..count), or nullptr
+			template <typename T>
+			const T * find(const T * p, size_t count, T c)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto needle = ops::splat(c);
+
+				// four vectors at a time, until we find a block that contains a match
+				for (; i + 4 * kStep <= count; i += 4 * kStep)
+				{
+					const auto m0 = ops::equal(load(p + i), needle);
+					const auto m1 = ops::equal(load(p + i + kStep), needle);
+					const auto m2 = ops::equal(load(p + i + 2 * kStep), needle);
+					const auto m3 = ops::equal(load(p + i + 3 * kStep), needle);
+					if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m0, m1), _mm_or_si128(m2, m3))))
+						break;
+				}
+
+				// one vector at a time
+				for (; i + kStep <= count; i += kStep)
+				{
+					if (const auto mask = to_mask<T>(ops::equal(load(p + i), needle)))
+						return p + i + lowest_bit(mask) / sizeof(T);
+				}
+#endif
+				for (; i < count; ++i)
+					if (p[i] == c)
+						return p + i;
+				return nullptr;
+			}
+
+			// returns the last occurrence of c in p[0..count), or nullptr
+			template <typename T>
+			const T * reverse_find(const T * p, size_t count, T c)
+			{
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto needle = ops::splat(c);
+
+				for (; count >= kStep; count -= kStep)
+				{
+					const auto i = count - kStep;
+					if (const auto mask = to_mask<T>(ops::equal(load(p + i), needle)))
+						return p + i + highest_bit(mask) / sizeof(T);
+				}
+#endif
+				while (count--)
+					if (p[count] == c)
+						return p + count;
+				return nullptr;
+			}
+
+			// does the needle match at p? (given that its first and last characters are already known to)
+			template <typename T>
+			bool matches_middle(const T * p, const T * needle, size_t length)
+			{
+				return length < 3 || std::memcmp(p + 1, needle + 1, (length - 2) * sizeof(T)) == 0;
+			}
+
+			// returns the first occurrence of needle[0..length) in p[0..count), or nullptr (requires 0 < length <= count)
+			template <typename T>
+			const T * search(const T * p, size_t count, const T * needle, size_t length)
+			{
+				if (length == 1)
+					return find(p, count, needle[0]);
+
+				// candidate positions are 0..last
+				const auto last = count - length;
+				const auto first_char = needle[0];
+				const auto last_char = needle[length - 1];
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto first = ops::splat(first_char);
+				const auto ending = ops::splat(last_char);
+
+				for (; i + kStep - 1 <= last; i += kStep)
+				{
+					const auto both = _mm_and_si128(ops::equal(load(p + i), first), ops::equal(load(p + i + length - 1), ending));
+					for (auto mask = to_mask<T>(both); mask; mask &= mask - 1)
+					{
+						const auto candidate = p + i + lowest_bit(mask) / sizeof(T);
+						if (matches_middle(candidate, needle, length))
+							return candidate;
+					}
+				}
+#endif
+				for (; i <= last; ++i)
+					if (p[i] == first_char && p[i + length - 1] == last_char && matches_middle(p + i, needle, length))
+						return p + i;
+				return nullptr;
+			}
+
+			// returns the last occurrence of needle[0..length) in p[0..count), or nullptr (requires 0 < length <= count)
+			template <typename T>
+			const T * reverse_search(const T * p, size_t count, const T * needle, size_t length)
+			{
+				if (length == 1)
+					return reverse_find(p, count, needle[0]);
+
+				// candidate positions are 0..end-1
+				auto end = count - length + 1;
+				const auto first_char = needle[0];
+				const auto last_char = needle[length - 1];
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto first = ops::splat(first_char);
+				const auto ending = ops::splat(last_char);
+
+				for (; end >= kStep; end -= kStep)
+				{
+					const auto i = end - kStep;
+					const auto both = _mm_and_si128(ops::equal(load(p + i), first), ops::equal(load(p + i + length - 1), ending));
+					for (auto mask = to_mask<T>(both); mask; )
+					{
+						const auto bit = highest_bit(mask);
+						const auto candidate = p + i + bit / sizeof(T);
+						if (matches_middle(candidate, needle, length))
+							return candidate;
+						mask &= ~(1u << bit);
+					}
+				}
+#endif
+				while (end--)
+					if (p[end] == first_char && p[end + length - 1] == last_char && matches_middle(p + end, needle, length))
+						return p + end;
+				return nullptr;
+			}
+
+			// returns the index of the first difference (ignoring case) between a[0..count) and b[0..count), or count if there is none
+			template <typename T>
+			size_t mismatch_no_case(const T * a, const T * b, size_t count)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				constexpr size_t kStep = 16 / sizeof(T);
+				for (; i + kStep <= count; i += kStep)
+				{
+					const auto same = sse2<sizeof(T)>::equal(fold_lower<T>(load(a + i)), fold_lower<T>(load(b + i)));
+					if (const auto mask = to_mask<T>(same) ^ sse2<sizeof(T)>::kMask)
+						return i + lowest_bit(mask) / sizeof(T);
+				}
+#endif
+				for (; i < count; ++i)
+					if (fold_lower(a[i]) != fold_lower(b[i]))
+						break;
+				return i;
+			}
+
+			// returns the index of the first difference (ignoring case) between the null terminated strings a and b, or of their common terminator
+			template <typename T>
+			TBX_NO_SANITIZE_ADDRESS size_t mismatch_no_case(const T * a, const T * b)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto zero = _mm_setzero_si128();
+				for (;;)
+				{
+					if (within_page(a + i) && within_page(b + i))
+					{
+						// (not load(), which would be address sanitized)
+						const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+						const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+						const auto same = ops::equal(fold_lower<T>(x), fold_lower<T>(y));
+						if (const auto mask = (to_mask<T>(same) ^ ops::kMask) | to_mask<T>(ops::equal(x, zero)))
+							return i + lowest_bit(mask) / sizeof(T);
+						i += kStep;
+					}
+					else
+					{
+						// one character at a time, until we're past the page boundary
+						for (const auto end = i + kStep; i < end; ++i)
+							if (fold_lower(a[i]) != fold_lower(b[i]) || !a[i])
+								return i;
+					}
+				}
+#else
+				for (;; ++i)
+					if (fold_lower(a[i]) != fold_lower(b[i]) || !a[i])
+						return i;
+#endif
+			}
+
+			// returns the index of the first character in p[0..count) which is (or, if !in, which isn't) in any of the given classes, or count if there is none
+			template <typename T>
+			size_t find_class(const T * p, size_t count, char_classes classes, bool in)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				constexpr size_t kStep = 16 / sizeof(T);
+				const uint32_t flip = in ? 0 : sse2<sizeof(T)>::kMask;
+				for (; i + kStep <= count; i += kStep)
+				{
+					if (const auto mask = to_mask<T>(class_matches<T>(load(p + i), classes)) ^ flip)
+						return i + lowest_bit(mask) / sizeof(T);
+				}
+#endif
+				for (; i < count; ++i)
+					if (has_char_class(p[i], classes) == in)
+						break;
+				return i;
+			}
+
+			// returns the index of the last character in p[0..count) which is (or, if !in, which isn't) in any of the given classes, or count if there is none
+			template <typename T>
+			size_t reverse_find_class(const T * p, size_t count, char_classes classes, bool in)
+			{
+				auto end = count;
+#ifdef TBX_SIMD_SSE2
+				constexpr size_t kStep = 16 / sizeof(T);
+				const uint32_t flip = in ? 0 : sse2<sizeof(T)>::kMask;
+				for (; end >= kStep; end -= kStep)
+				{
+					const auto i = end - kStep;
+					if (const auto mask = to_mask<T>(class_matches<T>(load(p + i), classes)) ^ flip)
+						return i + highest_bit(mask) / sizeof(T);
+				}
+#endif
+				while (end--)
+					if (has_char_class(p[end], classes) == in)
+						return end;
+				return count;
+			}
+
+			// returns the number of characters in p[0..count) which are in any of the given classes
+			template <typename T>
+			size_t count_class(const T * p, size_t count, char_classes classes)
+			{
+				size_t i = 0, total = 0;
+#ifdef TBX_SIMD_SSE2
+				constexpr size_t kStep = 16 / sizeof(T);
+				for (; i + kStep <= count; i += kStep)
+					total += bit_count(to_mask<T>(class_matches<T>(load(p + i), classes)));
+#endif
+				for (; i < count; ++i)
+					total += has_char_class(p[i], classes);
+				return total;
+			}
+
+			// returns the index of the first character in p[0..count) which is any of set[0..size), or count if there is none
+			template <typename T>
+			size_t find_any(const T * p, size_t count, const T * set, size_t size)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				// (larger sets, which are rare, are faster one character at a time)
+				constexpr size_t kMaxSet = 8;
+				if (size <= kMaxSet)
+				{
+					using ops = sse2<sizeof(T)>;
+					constexpr size_t kStep = 16 / sizeof(T);
+					__m128i needles[kMaxSet];
+					for (size_t j = 0; j < size; ++j)
+						needles[j] = ops::splat(set[j]);
+					for (; i + kStep <= count; i += kStep)
+					{
+						const auto x = load(p + i);
+						auto matches = _mm_setzero_si128();
+						for (size_t j = 0; j < size; ++j)
+							matches = _mm_or_si128(matches, ops::equal(x, needles[j]));
+						if (const auto mask = to_mask<T>(matches))
+							return i + lowest_bit(mask) / sizeof(T);
+					}
+				}
+#endif
+				for (; i < count; ++i)
+					for (size_t j = 0; j < size; ++j)
+						if (p[i] == set[j])
+							return i;
+				return count;
+			}
+
+			// converts A-Z to a-z (or a-z to A-Z) in p[0..count), stopping at a null, and returns the number of characters converted
+			template <bool upper, typename T>
+			size_t convert_case(T * p, size_t count)
+			{
+				size_t i = 0;
+#ifdef TBX_SIMD_SSE2
+				using ops = sse2<sizeof(T)>;
+				constexpr size_t kStep = 16 / sizeof(T);
+				const auto zero = _mm_setzero_si128();
+				for (; i + kStep <= count; i += kStep)
+				{
+					const auto x = load(p + i);
+					if (to_mask<T>(ops::equal(x, zero)))
+						break;
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), upper ? fold_upper<T>(x) : fold_lower<T>(x));
+				}
+#endif
+				for (; i < count && p[i]; ++i)
+					p[i] = upper ? fold_upper(p[i]) : fold_lower(p[i]);
+				return i;
+			}
+
+		}
+
+	}
+
+}
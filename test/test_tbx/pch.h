@@ -7,5 +7,7 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #endif //PCH_H
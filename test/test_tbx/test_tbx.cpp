@@ -9,14 +9,32 @@
 #include "tbx\BufferedAdaptor.h"
 #include "tbx\character_encoding.h"
 #include "tbx\CircularBuffer.h"
+#include "tbx\ClockCache.h"
+#include "tbx\coerce_strings.h"
 #include "tbx\core.h"
+#include "tbx\crt\alphanum sort.h"
 #include "tbx\CustomException.h"
+#include "tbx\deferred_log.h"
+#include "tbx\fixed_string.h"
 #include "tbx\for_each.h"
+#include "tbx\formatter.h"
+#include "tbx\hash.h"
+#include "tbx\intern_pool.h"
+#include "tbx\keyword_scanner.h"
+#include "tbx\mutex_stream.h"
+#include "tbx\no_case_map.h"
+#include "tbx\searcher.h"
 #include "tbx\noawait.h"
+#include "tbx\packed_strings.h"
+#include "tbx\parallel_sort.h"
+#include "tbx\perfect_hash.h"
 #include "tbx\AutoMalloc.h"
 #include "tbx\AutoStringBuffer.h"
 #include "tbx\BlowFish.h"
+#include "tbx\split.h"
 #include "tbx\strings.h"
+#include "tbx\string_sort.h"
+#include "tbx\string_builder.h"
 
 using namespace tbx;
 
@@ -160,6 +178,64 @@ SCENARIO("CircularBuffer")
 	}
 }
 
+SCENARIO("ClockCache")
+{
+	GIVEN("a full clock cache of 4 entries")
+	{
+		ClockCache<int, std::string, 4> cache;
+		for (int i = 1; i <= 4; ++i)
+			cache.Insert(i, std::to_string(i));
+		REQUIRE(cache.IsFull());
+
+		WHEN("entries 1 and 2 are hit, and another entry is inserted")
+		{
+			REQUIRE(*cache.Find(1) == "1");
+			REQUIRE(*cache.Find(2) == "2");
+			cache.Insert(5, "5");
+
+			THEN("the first unreferenced entry (3) is the one evicted")
+			{
+				REQUIRE(cache.GetCount() == 4);
+				REQUIRE(cache.Find(3) == nullptr);
+				REQUIRE(*cache.Find(1) == "1");
+				REQUIRE(*cache.Find(2) == "2");
+				REQUIRE(*cache.Find(4) == "4");
+				REQUIRE(*cache.Find(5) == "5");
+			}
+		}
+
+		WHEN("an entry is erased")
+		{
+			REQUIRE(cache.Erase(2));
+			REQUIRE_FALSE(cache.Erase(2));
+
+			THEN("its slot is reused without evicting anything else")
+			{
+				cache.Insert(6, "6");
+				for (int i : { 1, 3, 4, 6 })
+					REQUIRE(cache.Contains(i));
+				REQUIRE_FALSE(cache.Contains(2));
+			}
+		}
+	}
+
+	GIVEN("a sharded clock cache")
+	{
+		ShardedClockCache<int, int, 64, 4> cache;
+		for (int i = 0; i < 1000; ++i)
+			cache.Insert(i, i * 2);
+
+		THEN("it never exceeds its capacity, and whatever it holds is correct")
+		{
+			REQUIRE(cache.GetCount() <= cache.size());
+			for (int i = 0; i < 1000; ++i)
+				if (auto v = cache.Find(i))
+					REQUIRE(*v == i * 2);
+			REQUIRE(*cache.Find(999) == 1998);
+		}
+	}
+}
+
 SCENARIO("Clonable class hierarchies can be cloned")
 {
 	// an arbitrary clonable class hierarchy
@@ -321,6 +397,172 @@ SCENARIO("CContextException can be constructed from any combination of narrow or
 // 	invoke_async_lambda([] { return sqrt(3.3); });
 // }
 
+SCENARIO("mutex_stream writes whole lines from many threads without interleaving them")
+{
+	std::ostringstream os;
+	const int kThreads = 8;
+	const int kLines = 1000;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; ++t)
+		threads.emplace_back([&os, t] {
+			for (int i = 0; i < kLines; ++i)
+				mutex_stream(os) << "thread " << t << " line " << i << '\n';
+		});
+	for (auto & thread : threads)
+		thread.join();
+	log_lanes::flush();
+
+	// every line is intact, and each thread's lines are in the order it wrote them
+	std::istringstream is(os.str());
+	std::vector<int> next(kThreads, 0);
+	std::string word1, word2;
+	int t, i, count = 0;
+	while (is >> word1 >> t >> word2 >> i)
+	{
+		REQUIRE(word1 == "thread");
+		REQUIRE(word2 == "line");
+		REQUIRE(i == next[t]++);
+		++count;
+	}
+	REQUIRE(count == kThreads * kLines);
+}
+
+SCENARIO("mutex_stream formats into a reusable per-thread line buffer")
+{
+	std::ostringstream os;
+
+	GIVEN("a line longer than the line buffer's inline storage")
+	{
+		const std::string long_line(1000, 'x');
+		mutex_stream(os) << long_line << 42;
+		log_lanes::flush();
+		REQUIRE(os.str() == long_line + "42");
+	}
+
+	GIVEN("a mutex_stream which is used while formatting another's line")
+	{
+		auto inner = [&os] { mutex_stream(os) << "inner;"; return "outer"; };
+		mutex_stream(os) << inner() << ';';
+		log_lanes::flush();
+		REQUIRE(os.str() == "inner;outer;");
+	}
+}
+
+SCENARIO("log lanes can write a stream's lines to a file descriptor, or drop lines when a lane is full")
+{
+	std::ostringstream os;
+
+	GIVEN("a stream redirected to a temporary file")
+	{
+		auto file = std::tmpfile();
+		REQUIRE(file);
+#ifdef _MSC_VER
+		log_lanes::redirect(os, _fileno(file));
+#else
+		log_lanes::redirect(os, fileno(file));
+#endif
+		for (int i = 0; i < 100; ++i)
+			mutex_stream(os) << "line " << i << '\n';
+		log_lanes::flush();
+		log_lanes::redirect(os, -1);
+
+		THEN("the lines went to the file, and not to the stream")
+		{
+			REQUIRE(os.str().empty());
+
+			std::rewind(file);
+			char line[32];
+			for (int i = 0; i < 100; ++i)
+			{
+				REQUIRE(std::fgets(line, sizeof(line), file));
+				REQUIRE(std::string(line) == "line " + std::to_string(i) + "\n");
+			}
+			REQUIRE_FALSE(std::fgets(line, sizeof(line), file));
+		}
+		std::fclose(file);
+	}
+
+	GIVEN("the drop policy, and a flusher which only wakes up when it must")
+	{
+		log_lanes::set_when_full(log_lanes::when_full::drop);
+		log_lanes::set_flush_interval(std::chrono::hours(1));
+		log_lanes::set_flush_threshold(SIZE_MAX);
+
+		const auto dropped = log_lanes::get_dropped_count();
+		const std::string padding(100, '.');
+		const int kLines = 2000;
+		for (int i = 0; i < kLines; ++i)
+			mutex_stream(os) << padding << '\n';
+		log_lanes::flush();
+
+		log_lanes::set_when_full(log_lanes::when_full::block);
+		log_lanes::set_flush_interval(std::chrono::milliseconds(10));
+		log_lanes::set_flush_threshold(32 * 1024);
+
+		THEN("every line was either written or counted as dropped")
+		{
+			const auto text = os.str();
+			const auto written = std::count(text.begin(), text.end(), '\n');
+			REQUIRE(written + (log_lanes::get_dropped_count() - dropped) == kLines);
+		}
+	}
+}
+
+SCENARIO("deferred logging records raw arguments, and formats them on the flusher")
+{
+	std::ostringstream os;
+	const std::string name = "widget";
+	const int values[] = { 1, 2, 3 };
+
+	WHEN("records with every kind of argument are posted")
+	{
+		for (int i = 0; i < 3; ++i)
+			TBX_DEFERRED_LOG(os, "{} #{}: {} {} {} {} {{literal}}\n", name.c_str(), values[i], -1ll, 2.5, 'c', i == 1);
+		TBX_DEFERRED_LOG(os, "no arguments\n");
+		log_lanes::flush();
+
+		THEN("they are rendered in order, as whole lines")
+		{
+			REQUIRE(os.str() ==
+				"widget #1: -1 2.5 c false {literal}\n"
+				"widget #2: -1 2.5 c true {literal}\n"
+				"widget #3: -1 2.5 c false {literal}\n"
+				"no arguments\n");
+		}
+	}
+
+	WHEN("a string argument would exceed the maximum record size")
+	{
+		const std::string huge(deferred_log::kMaxRecordSize * 2, 'x');
+		TBX_DEFERRED_LOG(os, "{}|{}\n", huge, 42);
+		log_lanes::flush();
+
+		THEN("the string is truncated, but the record is still intact")
+		{
+			const auto text = os.str();
+			REQUIRE(text.size() < deferred_log::kMaxRecordSize);
+			REQUIRE(text.substr(text.size() - 4) == "|42\n");
+		}
+	}
+
+	WHEN("a record is decoded using only its format")
+	{
+		const deferred_log::format f = { "{} + {} = {}", "iis" };
+		char args[8 + 8 + 4 + 5];
+		const int64_t a = 2, b = 3;
+		const uint32_t length = 5;
+		std::memcpy(args, &a, 8);
+		std::memcpy(args + 8, &b, 8);
+		std::memcpy(args + 16, &length, 4);
+		std::memcpy(args + 20, "five!", 5);
+
+		std::string out;
+		deferred_log::render(out, f, args, sizeof(args));
+		REQUIRE(out == "2 + 3 = five!");
+	}
+}
+
 SCENARIO("counter() allows simple for-each syntax when you simply want a looping index from a start to end value, optionally with an arbitrary increment value")
 {
 	int i;
@@ -553,6 +795,1624 @@ SCENARIO("core strings and characters")
 	}
 }
 
+SCENARIO("find, reverse_find and GetLength agree with a simple character by character search, for every character type")
+{
+	// repetitive text (lots of near misses for the substring searches), with a marker character at a few places
+	auto check = [](auto zero) {
+		using T = decltype(zero);
+		for (size_t length = 0; length <= 80; ++length)
+		{
+			for (size_t marker : { size_t(0), length / 3, length / 2, length - 1, length + 1 })
+			{
+				std::basic_string<T> text(length, T('a'));
+				if (marker < length)
+					text[marker] = T('b');
+
+				// naive reference results
+				const auto first_b = text.find(T('b'));
+				const auto last_b = text.rfind(T('b'));
+				const T needle[] = { T('a'), T('a'), T('b'), T('a') };
+				const auto first_needle = text.find(needle, 0, 4);
+				const auto last_needle = text.rfind(needle, std::basic_string<T>::npos, 4);
+
+				auto psz = &text[0];
+				REQUIRE(find(psz, length, T('b')) == (first_b == text.npos ? nullptr : psz + first_b));
+				REQUIRE(reverse_find(psz, length, T('b')) == (last_b == text.npos ? nullptr : psz + last_b));
+				REQUIRE(find(psz, length + 1, needle, 4) == (first_needle == text.npos ? nullptr : psz + first_needle));
+				REQUIRE(reverse_find(psz, length + 1, needle, 4) == (last_needle == text.npos ? nullptr : psz + last_needle));
+
+				// a terminator limits the length
+				if (marker < length)
+					text[marker] = T(0);
+				REQUIRE(GetLength(text.c_str(), length) == std::min(marker, length));
+			}
+		}
+	};
+
+	check(char());
+	check(wchar_t());
+	check(char16_t());
+	check(char32_t());
+}
+
+SCENARIO("searcher finds the same matches as std::string, for short, long, periodic and case insensitive needles")
+{
+	// texts from a small alphabet (so that there are plenty of partial matches)
+	uint32_t seed = 12345;
+	auto random_text = [&seed](size_t length, const char * alphabet, size_t letters) {
+		std::string text(length, ' ');
+		for (auto & c : text)
+		{
+			seed = seed * 1664525 + 1013904223;
+			c = alphabet[(seed >> 16) % letters];
+		}
+		return text;
+	};
+
+	auto lowercase = [](std::string s) {
+		for (auto & c : s)
+			c = az_lower(c);
+		return s;
+	};
+
+	auto check = [&](const std::string & text, const std::string & needle) {
+		const searcher<char> exact(needle);
+		const auto first = text.find(needle);
+		const auto last = text.rfind(needle);
+		REQUIRE(exact.find(text) == (first == text.npos ? nullptr : text.data() + first));
+		REQUIRE(exact.reverse_find(text) == (last == text.npos ? nullptr : text.data() + last));
+
+		const searcher<char> no_case(lowercase(needle), case_sensitivity::no_case);
+		const auto lower_text = lowercase(text);
+		const auto first_no_case = lower_text.find(lowercase(needle));
+		const auto last_no_case = lower_text.rfind(lowercase(needle));
+		REQUIRE(no_case.find(text) == (first_no_case == text.npos ? nullptr : text.data() + first_no_case));
+		REQUIRE(no_case.reverse_find(text) == (last_no_case == text.npos ? nullptr : text.data() + last_no_case));
+	};
+
+	WHEN("the needles are arbitrary")
+	{
+		for (size_t length : { 0, 1, 2, 5, 16, 17, 40, 100 })
+			for (int i = 0; i < 50; ++i)
+				check(random_text(300, "abAB", 4), random_text(length, "abAB", 4));
+	}
+
+	WHEN("the needles and texts are periodic")
+	{
+		for (auto needle : { "aaaaaaaaaaaaaaaaaaaaaaaab", "baaaaaaaaaaaaaaaaaaaaaaaa", "abababababababababababababc", "abcabcabcabcabcabcabcabcabd" })
+		{
+			std::string text;
+			for (int i = 0; i < 30; ++i)
+				text += std::string(needle).substr(0, 3 + i % 20);
+			check(text, needle);
+			check(text + needle + text, needle);
+			check(needle + text + needle, needle);
+		}
+	}
+
+	THEN("character arrays are only searched up to their terminator, and every character type is supported")
+	{
+		const searcher<wchar_t> keyword(L"KEYWORD, and a long needle", case_sensitivity::no_case);
+		const wchar_t text[] = L"some keyword, and a long needle\0keyword, and a long needle";
+		REQUIRE(keyword.find(text) == text + 5);
+		REQUIRE(keyword.reverse_find(text) == text + 5);
+
+		const searcher<char32_t> letter(U"w");
+		const std::u32string_view wow(U"wow");
+		REQUIRE(letter.find(wow) == wow.data());
+		REQUIRE(letter.reverse_find(wow) == wow.data() + 2);
+	}
+}
+
+SCENARIO("keyword_scanner reports every occurrence of every keyword in a single pass")
+{
+	using match = std::pair<size_t, size_t>;
+
+	// brute force reference
+	auto find_all = [](const std::string & text, const std::vector<std::string> & keywords) {
+		std::vector<match> matches;
+		for (size_t end = 1; end <= text.size(); ++end)
+			for (size_t keyword = 0; keyword < keywords.size(); ++keyword)
+			{
+				const auto length = keywords[keyword].size();
+				if (length && length <= end && text.compare(end - length, length, keywords[keyword]) == 0)
+					matches.emplace_back(keyword, end - length);
+			}
+		return matches;
+	};
+
+	GIVEN("some overlapping XML-ish keywords")
+	{
+		const std::vector<std::string> keywords = { "<item", "</item>", "item", "id=", "d=", "", "item" };
+		const keyword_scanner<char> scanner(keywords.begin(), keywords.end());
+		const std::string text = "<items><item id=7>x</item><Item ID=8/></items>";
+
+		THEN("it finds the same matches as a brute force search")
+		{
+			std::vector<match> matches;
+			scanner.scan(text, [&](size_t keyword, size_t offset) { matches.emplace_back(keyword, offset); });
+			std::vector<match> expected = find_all(text, keywords);
+			REQUIRE(matches.size() == expected.size());
+			std::sort(matches.begin(), matches.end());
+			std::sort(expected.begin(), expected.end());
+			REQUIRE(matches == expected);
+		}
+
+		THEN("scanning in chunks finds the same matches, at offsets from the start of the stream")
+		{
+			for (size_t chunk = 1; chunk <= 7; ++chunk)
+			{
+				std::vector<match> matches;
+				keyword_scanner<char>::stream_state stream;
+				for (size_t offset = 0; offset < text.size(); offset += chunk)
+					scanner.scan(stream, text.data() + offset, std::min(chunk, text.size() - offset), [&](size_t keyword, size_t offset) { matches.emplace_back(keyword, offset); });
+				std::vector<match> expected = find_all(text, keywords);
+				std::sort(matches.begin(), matches.end());
+				std::sort(expected.begin(), expected.end());
+				REQUIRE(matches == expected);
+			}
+		}
+
+		THEN("case insensitive scanners also match keywords in other cases")
+		{
+			const keyword_scanner<char> no_case(keywords.begin(), keywords.end(), case_sensitivity::no_case);
+			size_t items = 0, ids = 0;
+			no_case.scan(text, [&](size_t keyword, size_t) { items += keyword == 0; ids += keyword == 3; });
+			REQUIRE(items == 3);
+			REQUIRE(ids == 2);
+		}
+	}
+
+	WHEN("there are lots of keywords from a small alphabet, and wide characters")
+	{
+		uint32_t seed = 42;
+		auto random_text = [&seed](size_t length) {
+			std::string text(length, ' ');
+			for (auto & c : text)
+			{
+				seed = seed * 1664525 + 1013904223;
+				c = "abc"[(seed >> 16) % 3];
+			}
+			return text;
+		};
+
+		std::vector<std::string> keywords;
+		std::vector<std::u16string> wide_keywords;
+		for (size_t i = 0; i < 60; ++i)
+		{
+			keywords.push_back(random_text(1 + i % 6));
+			wide_keywords.emplace_back(keywords.back().begin(), keywords.back().end());
+			wide_keywords.back()[0] += 0x400;
+		}
+		const auto text = random_text(2000);
+		std::u16string wide_text(text.begin(), text.end());
+		for (auto & c : wide_text)
+			c += c == u'a' ? 0x400 : 0;
+
+		const keyword_scanner<char> scanner(keywords.begin(), keywords.end());
+		std::vector<match> matches;
+		scanner.scan(text, [&](size_t keyword, size_t offset) { matches.emplace_back(keyword, offset); });
+		auto expected = find_all(text, keywords);
+		std::sort(matches.begin(), matches.end());
+		std::sort(expected.begin(), expected.end());
+		REQUIRE(matches == expected);
+
+		const keyword_scanner<char16_t> wide_scanner(wide_keywords.begin(), wide_keywords.end());
+		size_t wide_matches = 0;
+		wide_scanner.scan(wide_text, [&](size_t keyword, size_t offset) { REQUIRE(wide_text.compare(offset, wide_keywords[keyword].size(), wide_keywords[keyword]) == 0); ++wide_matches; });
+		REQUIRE(wide_matches > 0);
+	}
+}
+
+SCENARIO("compare_no_case, make_uppercase and make_lowercase agree with a simple character by character version, for every character type")
+{
+	auto check = [](auto zero) {
+		using T = decltype(zero);
+
+		// the reference: compare the upper case of each character, and then the lengths
+		auto reference = [](const T * first, const T * second) {
+			for (;; ++first, ++second)
+			{
+				if (!*first || !*second)
+					return !*first ? (*second ? -1 : 0) : +1;
+				const auto ch1 = az_upper(*first);
+				const auto ch2 = az_upper(*second);
+				if (ch1 != ch2)
+					return ch1 < ch2 ? -1 : +1;
+			}
+		};
+		auto sign = [](strcmpcode result) { return result < 0 ? -1 : result > 0 ? +1 : 0; };
+
+		// place strings so that they end near a page boundary (where we mustn't read ahead)
+		std::vector<T> buffer(3 * 4096 / sizeof(T));
+		const auto page_end = reinterpret_cast<T *>((reinterpret_cast<uintptr_t>(buffer.data()) + 2 * 4096) & ~uintptr_t(4095));
+
+		const T letters[] = { T('a'), T('Z'), T('_'), T('@'), T('['), T(0x7F), T(-1), T('q'), T('Q') };
+		uint32_t seed = 7;
+		for (int i = 0; i < 2000; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			const size_t length = (seed >> 8) % 40;
+			std::basic_string<T> first, second;
+			for (size_t n = 0; n < length; ++n)
+			{
+				seed = seed * 1664525 + 1013904223;
+				const auto c = letters[(seed >> 12) % 9];
+				first += c;
+				second += (seed >> 20) % 8 ? T(is_alphabetical(c) ? c ^ 0x20 : c) : letters[(seed >> 24) % 9];
+			}
+			if ((seed >> 28) % 4 == 0)
+				second.resize((seed >> 4) % (length + 1));
+
+			auto a = page_end - (first.size() + 1);
+			std::copy(first.c_str(), first.c_str() + first.size() + 1, a);
+			auto b = second.c_str();
+
+			REQUIRE(sign(compare_no_case(a, b)) == reference(a, b));
+			REQUIRE(sign(compare_no_case(b, a)) == reference(b, a));
+			const auto common = std::min(first.size(), second.size());
+			REQUIRE(sign(compare_no_case(a, b, common)) == reference(std::basic_string<T>(a, common).c_str(), std::basic_string<T>(b, common).c_str()));
+
+			// case conversion stops at the terminator (or the bound)
+			auto upper = first + T(0) + T('x');
+			make_uppercase(&upper[0], upper.size());
+			auto lower = first;
+			make_lowercase(&lower[0], lower.size() / 2);
+			for (size_t n = 0; n < first.size(); ++n)
+			{
+				REQUIRE(upper[n] == az_upper(first[n]));
+				REQUIRE(lower[n] == (n < first.size() / 2 ? az_lower(first[n]) : first[n]));
+			}
+			REQUIRE(upper.back() == T('x'));
+		}
+		REQUIRE(compare_no_case((const T *)nullptr, LITERAL(T, "")) == 0);
+		REQUIRE(compare_no_case((const T *)nullptr, LITERAL(T, "a")) < 0);
+	};
+
+	check(char());
+	check(wchar_t());
+	check(char16_t());
+	check(char32_t());
+}
+
+SCENARIO("character classes come from a table, and bulk scanners find, count and trim by class")
+{
+	THEN("the classifiers agree with the classic locale for ASCII, and treat everything else as printable")
+	{
+		for (int c = 0; c < 0x80; ++c)
+		{
+			REQUIRE(is_control(char(c)) == !!std::iscntrl(c));
+			REQUIRE(is_whitespace(char(c)) == !!std::isspace(c));
+			REQUIRE(is_lowercase(char(c)) == !!std::islower(c));
+			REQUIRE(is_uppercase(char(c)) == !!std::isupper(c));
+			REQUIRE(is_digit(wchar_t(c)) == !!std::isdigit(c));
+			REQUIRE(is_hex_digit(char16_t(c)) == !!std::isxdigit(c));
+			REQUIRE(is_alphanumeric(char32_t(c)) == !!std::isalnum(c));
+		}
+		REQUIRE(get_char_classes(char(0xE9)) == char_class::printable);
+		REQUIRE(get_char_classes(L'\x3000') == char_class::printable);
+		static_assert(is_digit('7') && !is_digit('x'), "classification is constexpr");
+	}
+
+	auto check = [](auto zero) {
+		using T = decltype(zero);
+		const char_classes all[] = { char_class::control, char_class::printable, char_class::whitespace, char_class::lowercase, char_class::uppercase,
+			char_class::digit, char_class::hex_digit, char_class::alphanumeric, char_class::whitespace | char_class::digit };
+		const T letters[] = { T(' '), T('\t'), T('a'), T('G'), T('f'), T('5'), T(0x7F), T(-1), T(0xE9), T('_') };
+
+		uint32_t seed = 3;
+		for (size_t length = 0; length <= 70; ++length)
+		{
+			std::basic_string<T> text;
+			for (size_t n = 0; n < length; ++n)
+			{
+				seed = seed * 1664525 + 1013904223;
+				text += letters[(seed >> 16) % 10];
+			}
+			const auto psz = text.data();
+			for (auto classes : all)
+			{
+				auto in = [classes](T c) { return has_char_class(c, classes); };
+				auto out = [classes](T c) { return !has_char_class(c, classes); };
+				auto pointer = [&](auto found) { return found == text.end() ? nullptr : psz + (found - text.begin()); };
+				auto reverse_pointer = [&](auto found) { return found == text.rend() ? nullptr : psz + (text.rend() - found - 1); };
+				REQUIRE(find_first_of_class(psz, length, classes) == pointer(std::find_if(text.begin(), text.end(), in)));
+				REQUIRE(find_first_not_of_class(psz, length, classes) == pointer(std::find_if(text.begin(), text.end(), out)));
+				REQUIRE(find_last_of_class(psz, length, classes) == reverse_pointer(std::find_if(text.rbegin(), text.rend(), in)));
+				REQUIRE(find_last_not_of_class(psz, length, classes) == reverse_pointer(std::find_if(text.rbegin(), text.rend(), out)));
+				REQUIRE(count_class(psz, length, classes) == size_t(std::count_if(text.begin(), text.end(), in)));
+			}
+		}
+	};
+
+	check(char());
+	check(wchar_t());
+	check(char16_t());
+	check(char32_t());
+
+	THEN("trim removes whitespace from either or both ends")
+	{
+		std::string s = " \t\r\n  some text \v\f ";
+		auto left = s, right = s, both = s;
+		trim_left(left);
+		trim_right(right);
+		trim(both);
+		REQUIRE(left == "some text \v\f ");
+		REQUIRE(right == " \t\r\n  some text");
+		REQUIRE(both == "some text");
+
+		std::wstring blank(40, L' ');
+		trim(blank);
+		REQUIRE(blank.empty());
+	}
+}
+
+SCENARIO("trim, find and compare work on string views without copying")
+{
+	GIVEN("a view of a padded field")
+	{
+		const std::string line = "name =  \t value with spaces \r\n";
+		const std::string_view field = std::string_view(line).substr(6);
+
+		THEN("trimming narrows the view, within the original characters")
+		{
+			REQUIRE(trim_left(field) == "value with spaces \r\n");
+			REQUIRE(trim_right(field) == "  \t value with spaces");
+			const auto value = trim(field);
+			REQUIRE(value == "value with spaces");
+			REQUIRE(value.data() == line.data() + line.find('v'));
+			REQUIRE(trim(std::string_view(" \t ")).empty());
+			REQUIRE(trim(std::wstring_view()).empty());
+		}
+
+		THEN("find and reverse_find search the whole view, and return pointers into it")
+		{
+			const std::string_view with_null("a\0b a\0b", 7);
+			REQUIRE(find(with_null, 'b') == with_null.data() + 2);
+			REQUIRE(reverse_find(with_null, 'b') == with_null.data() + 6);
+			REQUIRE(find(with_null, std::string_view("\0b", 2)) == with_null.data() + 1);
+			REQUIRE(reverse_find(with_null, std::string_view("\0b", 2)) == with_null.data() + 5);
+			REQUIRE(find(field, std::string_view("spaces!")) == nullptr);
+			REQUIRE(find(field, std::string_view()) == field.data());
+			REQUIRE(reverse_find(field, std::string_view()) == field.data() + field.size());
+		}
+
+		THEN("compare and compare_no_case order views like strings")
+		{
+			REQUIRE(compare(std::string_view("abc"), std::string_view("abd")) < 0);
+			REQUIRE(compare(std::string_view("abc"), std::string_view("ab")) > 0);
+			REQUIRE(compare(trim(field), std::string_view("value with spaces")) == 0);
+			REQUIRE(compare_no_case(trim(field), std::string_view("VALUE With Spaces")) == 0);
+			REQUIRE(compare_no_case(std::u16string_view(u"Value"), std::u16string_view(u"VALUES")) < 0);
+			REQUIRE(compare_no_case(std::string_view("b"), std::string_view("A")) > 0);
+		}
+	}
+
+	THEN("in place trims give the same results")
+	{
+		for (auto text : { "", "   ", "x", "  x", "x  ", " \tx y\n ", "no padding" })
+		{
+			std::string left = text, right = text, both = text;
+			trim_left(left);
+			trim_right(right);
+			trim(both);
+			REQUIRE(left == trim_left(std::string_view(text)));
+			REQUIRE(right == trim_right(std::string_view(text)));
+			REQUIRE(both == trim(std::string_view(text)));
+		}
+	}
+}
+
+SCENARIO("format() writes its arguments into a format that is checked at compile time")
+{
+	enum class colour { red = 1, green = 2 };
+	const std::string name = "widget";
+
+	THEN("arguments of every supported type are formatted like printf would")
+	{
+		REQUIRE(format(TBX_FORMAT("no fields")) == "no fields");
+		REQUIRE(format(TBX_FORMAT("{} {} {} {}"), true, 'c', -42, 42u) == "true c -42 42");
+		REQUIRE(format(TBX_FORMAT("{} and {} and {}"), name, std::string_view("view"), "literal") == "widget and view and literal");
+		REQUIRE(format(TBX_FORMAT("{} {}"), colour::green, 0.5) == "2 0.5");
+		REQUIRE(format(TBX_FORMAT("{{{}}} }}{{"), 1) == "{1} }{");
+		REQUIRE(format(TBX_FORMAT("{}"), (const char *)nullptr) == "");
+		REQUIRE(format(TBX_FORMAT("{}"), (void *)nullptr) == "0x0");
+	}
+
+	THEN("specs control width, alignment, padding, precision and base")
+	{
+		REQUIRE(format(TBX_FORMAT("[{:5}][{:<5}][{:05}][{:05}]"), 42, 42, 42, -42) == "[   42][42   ][00042][-0042]");
+		REQUIRE(format(TBX_FORMAT("{:x} {:X} {:o} {:b} {:08X}"), 255, 255, 8, 5, 0xBEEFu) == "ff FF 10 101 0000BEEF");
+		REQUIRE(format(TBX_FORMAT("{:.2f} {:.3e} {:.3g} {:f}"), 3.14159, 31415.9, 0.000123456, 2.5) == format_string("%.2f %.3e %.3g 2.5", 3.14159, 31415.9, 0.000123456));
+		REQUIRE(format(TBX_FORMAT("[{:>8.3}][{:<8}]"), name, name) == "[     wid][widget  ]");
+		REQUIRE(format(TBX_FORMAT("{:.0f}"), 1e300).size() == 301);
+	}
+
+	THEN("fixed notation of tiny values writes all of their leading zeros")
+	{
+		for (const double value : { 1e-300, std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min(), -std::numeric_limits<double>::denorm_min() })
+		{
+			char expected[512];
+			const auto end = std::to_chars(expected, std::end(expected), value, std::chars_format::fixed).ptr;
+			REQUIRE(format(TBX_FORMAT("{:f}"), value) == std::string(expected, end));
+
+			std::string s = "x";
+			format_append(s, TBX_FORMAT("{:f}|{:f}"), value, value);
+			REQUIRE(s == "x" + std::string(expected, end) + "|" + std::string(expected, end));
+		}
+	}
+
+	THEN("it can append to a string, write to an output iterator, or into a fixed buffer")
+	{
+		std::string s = "count: ";
+		format_append(s, TBX_FORMAT("{} of {}"), 3, 4);
+		REQUIRE(s == "count: 3 of 4");
+
+		std::string target;
+		format_to(make_string_back_inserter(target), TBX_FORMAT("{}-{}"), name, 7);
+		REQUIRE(target == "widget-7");
+
+		char buffer[16];
+		REQUIRE(format_to(buffer, TBX_FORMAT("{:04}|{}"), 7, name) == "0007|widget");
+		REQUIRE(buffer[11] == 0);
+		REQUIRE_THROWS_AS(format_to(buffer, TBX_FORMAT("{} is too long"), name), std::range_error);
+	}
+
+	THEN("format_string() copes with output that needs a second attempt")
+	{
+		const std::string long_text(200, 'x');
+		REQUIRE(format_string("%s%d", long_text.c_str(), 42) == long_text + "42");
+	}
+}
+
+SCENARIO("string_builder accumulates text in chunks, and materializes it once")
+{
+	GIVEN("a builder with a few megabytes of mixed appends")
+	{
+		string_builder builder;
+		std::string expected;
+		for (int i = 0; builder.size() < 3 * 1024 * 1024; ++i)
+		{
+			const auto line = std::to_string(i) + " bottles of beer on the wall\n";
+			builder += line;
+			expected += line;
+			builder += 'x';
+			expected += 'x';
+			if (i % 1000 == 0)
+			{
+				const std::string big(5000 + i % 7, char('a' + i % 26));
+				builder.append(big.data(), big.size());
+				expected += big;
+			}
+		}
+
+		THEN("str(), segments() and copy() all give back what was appended")
+		{
+			REQUIRE(builder.size() == expected.size());
+			REQUIRE(builder.str() == expected);
+
+			std::string joined;
+			for (auto segment : builder.segments())
+				joined += segment;
+			REQUIRE(joined == expected);
+			REQUIRE(builder.segments().size() < 20);
+
+			std::string copied;
+			builder.copy(std::back_inserter(copied));
+			REQUIRE(copied == expected);
+		}
+
+		THEN("clear() empties it for reuse")
+		{
+			builder.clear();
+			REQUIRE(builder.empty());
+			builder += "again";
+			REQUIRE(builder.str() == "again");
+			REQUIRE(builder.segments().size() == 1);
+		}
+	}
+
+	THEN("it is a target for the back inserters")
+	{
+		const std::string text = "inserted one character at a time";
+		string_builder builder;
+		std::copy(text.begin(), text.end(), make_string_back_inserter(builder));
+		*make_string_back_inserter(builder) = "!";
+		std::copy(text.begin(), text.begin() + 8, std::back_inserter(builder));
+		REQUIRE(builder.str() == text + "!inserted");
+
+		wstring_builder wide;
+		wide.append(3, L'w');
+		wide += L"ide";
+		REQUIRE(wide.str() == L"wwwide");
+	}
+}
+
+SCENARIO("fixed_character_back_insert_iterator accumulates characters and runs of characters into a fixed buffer")
+{
+	GIVEN("a buffer which already holds a string")
+	{
+		char buffer[16] = "abc";
+		auto out = make_string_back_inserter(buffer);
+
+		THEN("characters, strings, views and ranges are appended, and the buffer stays terminated")
+		{
+			*out++ = 'd';
+			out = "ef";
+			out = std::string_view("gh");
+			out = std::string("ij");
+			const std::vector<char> kl = { 'k', 'l' };
+			out = kl;
+			const std::string mn = "mn";
+			out.append(mn.begin(), mn.end());
+			REQUIRE(std::string(buffer) == "abcdefghijklmn");
+			REQUIRE(out.length() == 14);
+		}
+
+		THEN("a run which doesn't fit is rejected as a whole")
+		{
+			out = "0123456789AB";
+			REQUIRE_THROWS_AS(out = "CD", std::range_error);
+			REQUIRE(std::string(buffer) == "abc0123456789AB");
+			REQUIRE(out.full());
+			REQUIRE_THROWS_AS(out = 'x', std::range_error);
+		}
+
+		THEN("std algorithms can use it as an output iterator")
+		{
+			const std::string text = "-xyz";
+			std::copy(text.begin(), text.end(), make_string_back_inserter(buffer));
+			REQUIRE(std::string(buffer) == "abc-xyz");
+		}
+	}
+
+	GIVEN("deferred termination")
+	{
+		wchar_t buffer[8];
+		std::fill(std::begin(buffer), std::end(buffer), L'?');
+		buffer[0] = 0;
+		{
+			fixed_character_back_insert_iterator<wchar_t, 8, overflow_policy::throw_range_error, termination_policy::on_flush> out(buffer);
+			out = L"wide";
+			REQUIRE(buffer[4] == L'?');
+			out.flush();
+			REQUIRE(std::wstring(buffer) == L"wide");
+
+			out = L'!';
+			REQUIRE(buffer[5] == L'?');
+		}
+
+		THEN("the terminator is written when it goes out of scope")
+		{
+			REQUIRE(std::wstring(buffer) == L"wide!");
+		}
+	}
+
+	GIVEN("deferred termination, with copies of the iterator appending")
+	{
+		char buffer[16];
+		std::fill(std::begin(buffer), std::end(buffer), '?');
+		buffer[0] = 0;
+		const char x[] = "xyz";
+		{
+			auto out = make_string_back_inserter<char, 16, overflow_policy::throw_range_error, termination_policy::on_flush>(buffer);
+			out = "prefix";
+			std::copy(x, x + 3, out);
+			REQUIRE(std::string(buffer) == "prefixxyz");
+			out.flush();
+		}
+
+		THEN("the iterator left behind doesn't terminate the buffer where it had got to")
+		{
+			REQUIRE(std::string(buffer) == "prefixxyz");
+		}
+	}
+}
+
+SCENARIO("fixed_string builds strings inline, knowing its length")
+{
+	GIVEN("a fixed_string")
+	{
+		fixed_string<char, 15> s("key");
+
+		THEN("it appends characters, strings and views, and stays terminated")
+		{
+			s += '.';
+			s += "name";
+			s += std::string_view("._");
+			s.append(std::string("value"));
+			REQUIRE(s == "key.name._value");
+			REQUIRE(s.full());
+			REQUIRE(std::strlen(s.c_str()) == s.length());
+			REQUIRE(GetLength(s) == 15);
+			REQUIRE(std::string(get_string(s)) == "key.name._value");
+		}
+
+		THEN("an append which doesn't fit throws, and leaves the string as it was")
+		{
+			s.append(12, 'x');
+			REQUIRE_THROWS_AS(s += '!', std::range_error);
+			REQUIRE_THROWS_AS(s += "!!", std::range_error);
+			REQUIRE(s == "keyxxxxxxxxxxxx");
+		}
+
+		THEN("it supports the strings.h operations")
+		{
+			copy(s, "  Mixed Case  ");
+			trim(s);
+			REQUIRE(s == "Mixed Case");
+			REQUIRE(s.compare_no_case("MIXED CASE") == 0);
+			REQUIRE(s.compare("Mixed") > 0);
+			REQUIRE(s.find(' ') == s.data() + 5);
+			REQUIRE(s.reverse_find("e") == s.data() + 9);
+			REQUIRE(s.find("nope") == nullptr);
+			make_uppercase(s);
+			REQUIRE(s == std::string("MIXED CASE"));
+			concatenate(s, "!!!", 1);
+			REQUIRE(s == "MIXED CASE!");
+
+			const std::string text = "+tai";
+			std::copy(text.begin(), text.end(), make_string_back_inserter(s));
+			REQUIRE(s == "MIXED CASE!+tai");
+			REQUIRE_THROWS_AS(*make_string_back_inserter(s) = 'l', std::range_error);
+		}
+
+		THEN("it copies like a value, and compares with other strings")
+		{
+			auto t = s;
+			t += '2';
+			REQUIRE(s == "key");
+			REQUIRE(s != t);
+			REQUIRE(s < t);
+			REQUIRE(std::string("key") == s);
+			REQUIRE(fixed_string<char, 31>(s) == s);
+			REQUIRE(std::is_trivially_copyable_v<decltype(s)>);
+		}
+	}
+
+	GIVEN("a truncating fixed_string")
+	{
+		fixed_string<wchar_t, 4, overflow_policy::truncate> s(L"wide string");
+
+		THEN("it keeps what fits")
+		{
+			REQUIRE(s == L"wide");
+			s.pop_back();
+			s += L"sp";
+			REQUIRE(s == L"wids");
+		}
+	}
+}
+
+SCENARIO("intern_pool maps equal strings to the same symbol")
+{
+	GIVEN("a case sensitive pool")
+	{
+		intern_pool pool;
+		const auto item = pool.intern("item");
+		const auto id = pool.intern("id");
+
+		THEN("equal strings have equal symbols, and different strings different ones")
+		{
+			REQUIRE(item != id);
+			REQUIRE(pool.intern(std::string("item")) == item);
+			REQUIRE(pool.intern("Item") != item);
+			REQUIRE(pool.find("id") == id);
+			REQUIRE(pool.find("missing") == symbol::none);
+			REQUIRE(pool.size() == 3);
+		}
+
+		THEN("the symbols give back their strings")
+		{
+			REQUIRE(pool.view(item) == "item");
+			REQUIRE(std::string(pool.c_str(id)) == "id");
+			REQUIRE(pool.view(symbol::none).empty());
+			REQUIRE(pool.view(pool.intern("")).empty());
+		}
+
+		THEN("symbols and strings survive the pool growing")
+		{
+			std::vector<symbol> symbols;
+			const auto first = pool.c_str(item);
+			for (int i = 0; i < 5000; ++i)
+				symbols.push_back(pool.intern("symbol #" + std::to_string(i)));
+			for (int i = 0; i < 5000; ++i)
+				REQUIRE(pool.find("symbol #" + std::to_string(i)) == symbols[i]);
+			REQUIRE(pool.c_str(item) == first);
+			REQUIRE(pool.view(symbols[4321]) == "symbol #4321");
+		}
+	}
+
+	GIVEN("a case insensitive pool")
+	{
+		intern_pool pool(case_sensitivity::no_case);
+		const auto header = pool.intern("Content-Length");
+
+		THEN("strings which differ only in case share a symbol, and keep their first spelling")
+		{
+			REQUIRE(pool.intern("content-length") == header);
+			REQUIRE(pool.find("CONTENT-LENGTH") == header);
+			REQUIRE(pool.find("Content-Length2") == symbol::none);
+			REQUIRE(pool.view(header) == "Content-Length");
+			REQUIRE(pool.is_no_case());
+		}
+	}
+
+	GIVEN("many threads interning overlapping strings at once")
+	{
+		intern_pool pool;
+		constexpr int kThreads = 8;
+		constexpr int kStrings = 2000;
+		std::vector<std::vector<symbol>> results(kThreads);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < kThreads; ++t)
+			threads.emplace_back([&pool, &results, t] {
+				for (int i = 0; i < kStrings; ++i)
+				{
+					const auto n = (i * 7 + t * 13) % kStrings;
+					results[t].push_back(pool.intern("key" + std::to_string(n)));
+				}
+			});
+		for (auto & thread : threads)
+			thread.join();
+
+		THEN("every thread got the same symbol for the same string")
+		{
+			REQUIRE(pool.size() == kStrings);
+			for (int t = 0; t < kThreads; ++t)
+				for (int i = 0; i < kStrings; ++i)
+				{
+					const auto n = (i * 7 + t * 13) % kStrings;
+					REQUIRE(pool.view(results[t][i]) == "key" + std::to_string(n));
+				}
+		}
+	}
+}
+
+SCENARIO("As<>, Assign() and parse_number() convert between strings and numbers")
+{
+	GIVEN("strings which are numbers")
+	{
+		THEN("they convert to every arithmetic type")
+		{
+			REQUIRE(As<int>("42") == 42);
+			REQUIRE(As<int>(std::string(" -42 ")) == -42);
+			REQUIRE(As<long long>(std::string_view("+9223372036854775807")) == std::numeric_limits<long long>::max());
+			REQUIRE(As<long long>("-9223372036854775808") == std::numeric_limits<long long>::min());
+			REQUIRE(As<uint64_t>("18446744073709551615") == std::numeric_limits<uint64_t>::max());
+			REQUIRE(As<uint64_t>("000000000000000000000000000001234567890123") == 1234567890123);
+			REQUIRE(As<int8_t>("-128") == -128);
+			REQUIRE(As<double>("3.25") == 3.25);
+			REQUIRE(As<float>("-1e3") == -1000.0f);
+			REQUIRE(As<bool>("TRUE"));
+			REQUIRE(!As<bool>("0"));
+			REQUIRE(As<bool>("2.5"));
+		}
+
+		THEN("every length of number is parsed correctly")
+		{
+			uint64_t expected = 0;
+			std::string digits;
+			for (int i = 0; i < 19; ++i)
+			{
+				digits += char('1' + i % 9);
+				expected = expected * 10 + (1 + i % 9);
+				uint64_t value = 0;
+				REQUIRE(parse_number(digits, value));
+				REQUIRE(value == expected);
+			}
+		}
+	}
+
+	GIVEN("strings which aren't numbers, or don't fit")
+	{
+		THEN("As<> throws")
+		{
+			REQUIRE_THROWS_AS(As<int>("12abc"), std::invalid_argument);
+			REQUIRE_THROWS_AS(As<int>(""), std::invalid_argument);
+			REQUIRE_THROWS_AS(As<int>((const char *)nullptr), std::invalid_argument);
+			REQUIRE_THROWS_AS(As<unsigned>("-1"), std::invalid_argument);
+			REQUIRE_THROWS_AS(As<uint8_t>("256"), std::out_of_range);
+			REQUIRE_THROWS_AS(As<int64_t>("9223372036854775808"), std::out_of_range);
+			REQUIRE_THROWS_AS(As<uint64_t>("18446744073709551616"), std::out_of_range);
+			REQUIRE_THROWS_AS(As<uint64_t>("99999999999999999999"), std::out_of_range);
+			REQUIRE_THROWS_AS(As<double>("1e999"), std::out_of_range);
+		}
+
+		THEN("Assign() and parse_number() return false, and leave the target alone")
+		{
+			int count = 7;
+			REQUIRE(!Assign(count, "seven"));
+			REQUIRE(!Assign(count, std::string("99999999999")));
+			REQUIRE(!parse_number("1 2", count));
+			REQUIRE(!parse_number("+-5", count));
+			REQUIRE(!parse_number("++5", count));
+			REQUIRE(count == 7);
+
+			double number = 7;
+			bool flag = false;
+			REQUIRE(!parse_number("+-1.5", number));
+			REQUIRE(number == 7);
+			REQUIRE(!parse_number("+true", flag));
+			REQUIRE(!parse_number("+-1", flag));
+			REQUIRE(parse_number("+1", flag));
+			REQUIRE(flag);
+			REQUIRE(Assign(count, "8"));
+			REQUIRE(count == 8);
+		}
+	}
+
+	GIVEN("numbers")
+	{
+		THEN("they convert to their shortest text")
+		{
+			REQUIRE(As<std::string>(-42) == "-42");
+			REQUIRE(As<std::string>(uint64_t(18446744073709551615u)) == "18446744073709551615");
+			REQUIRE(As<std::string>(0.1) == "0.1");
+			REQUIRE(As<std::string>(true) == "true");
+			REQUIRE(As<double>(As<std::string>(1.0 / 3)) == 1.0 / 3);
+		}
+	}
+}
+
+SCENARIO("split() lazily splits text into fields")
+{
+	auto fields = [](auto && range) {
+		std::vector<std::string> result;
+		for (auto field : range)
+			result.emplace_back(field);
+		return result;
+	};
+	using strings = std::vector<std::string>;
+
+	GIVEN("a single delimiter")
+	{
+		THEN("each delimiter separates two fields")
+		{
+			REQUIRE(fields(split("a,b,,c", ",")) == strings{ "a", "b", "", "c" });
+			REQUIRE(fields(split(",a,", ",")) == strings{ "", "a", "" });
+			REQUIRE(fields(split("", ",")) == strings{ "" });
+			REQUIRE(fields(split(std::string_view("no delimiters"), ",")) == strings{ "no delimiters" });
+		}
+
+		THEN("empty fields can be skipped")
+		{
+			REQUIRE(fields(split(",,a,,b,", ",", empty_fields::skip)) == strings{ "a", "b" });
+			REQUIRE(fields(split(",,,", ",", empty_fields::skip)).empty());
+			REQUIRE(fields(split("", ",", empty_fields::skip)).empty());
+		}
+
+		THEN("the fields are views of the text")
+		{
+			const std::string text = "key=value";
+			auto range = split(text, "=");
+			auto field = range.begin();
+			REQUIRE(field->data() == text.data());
+			++field;
+			REQUIRE(field->data() == text.data() + 4);
+			REQUIRE(++field == range.end());
+		}
+	}
+
+	GIVEN("several delimiters")
+	{
+		THEN("any of them ends a field")
+		{
+			REQUIRE(fields(split("a=1&b=2;c", "&;")) == strings{ "a=1", "b=2", "c" });
+			auto wide = split(L"one two\tthree\nfour", L" \t\n");
+			REQUIRE(std::distance(wide.begin(), wide.end()) == 4);
+			REQUIRE(*std::next(wide.begin(), 2) == L"three");
+			REQUIRE(fields(split("1 2\t3\n4\r5\v6\f7.8,9:10;", " \t\n\r\v\f.,:;", empty_fields::skip)).size() == 10);
+		}
+	}
+
+	GIVEN("quoting")
+	{
+		THEN("delimiters within quotes are ignored, and the quotes are removed")
+		{
+			REQUIRE(fields(split(R"(1,"two, three",4)", ",", empty_fields::keep, '"')) == strings{ "1", "two, three", "4" });
+			REQUIRE(fields(split(R"("say ""hi""",x)", ",", empty_fields::keep, '"')) == strings{ R"(say ""hi"")", "x" });
+			REQUIRE(fields(split(R"("",a)", ",", empty_fields::skip, '"')) == strings{ "a" });
+			REQUIRE(fields(split(R"(a,"unterminated, quote)", ",", empty_fields::keep, '"')) == strings{ "a", "unterminated, quote" });
+		}
+	}
+
+	GIVEN("a long text")
+	{
+		std::string text;
+		for (int i = 0; i < 1000; ++i)
+			text += std::to_string(i) + (i % 3 ? "," : ";");
+
+		THEN("every field is found")
+		{
+			const auto found = fields(split(text, ",;", empty_fields::skip));
+			REQUIRE(found.size() == 1000);
+			REQUIRE(found[999] == "999");
+			REQUIRE(std::distance(split(text, ",").begin(), split(text, ",").end()) == 667);
+		}
+	}
+}
+
+SCENARIO("hash_string() hashes strings, optionally ignoring case, at runtime or at compile time")
+{
+	GIVEN("strings of every length up to a few stripes")
+	{
+		std::string text, shouted;
+		for (int i = 0; i < 300; ++i)
+		{
+			const char c = "abcdefghijklmnopqrstuvwxyz0123456789-_@[`{\x80\xC1\xFF"[i % 45];
+			text += c;
+			shouted += char(az_upper(c));
+		}
+
+		THEN("the runtime and constexpr hashes agree, and folding case matches compare_no_case()")
+		{
+			for (size_t length = 0; length <= text.size(); ++length)
+			{
+				const std::string_view view(text.data(), length);
+				const std::string_view upper(shouted.data(), length);
+				REQUIRE(hash_string(view) == constexpr_hash_string(view));
+				REQUIRE(hash_string(view, 42) == constexpr_hash_string(view, 42));
+				REQUIRE(hash_string_no_case(view) == constexpr_hash_string_no_case(view));
+				REQUIRE(hash_string_no_case(upper) == hash_string_no_case(view));
+				REQUIRE(constexpr_hash_string_no_case(upper) == hash_string_no_case(view));
+			}
+		}
+
+		THEN("case, the seed and every character matter")
+		{
+			REQUIRE(hash_string(text) != hash_string(shouted));
+			REQUIRE(hash_string(text) != hash_string(text, 1));
+			for (size_t i = 0; i < text.size(); i += 7)
+			{
+				auto changed = text;
+				changed[i] ^= 1;
+				REQUIRE(hash_string(changed) != hash_string(text));
+				REQUIRE(hash_string_no_case(changed) != hash_string_no_case(text));
+			}
+			REQUIRE(hash_string(std::string_view("a\0", 2)) != hash_string("a"));
+		}
+	}
+
+	GIVEN("literals")
+	{
+		THEN("they can be hashed at compile time")
+		{
+			constexpr auto kGet = constexpr_hash_string("GET");
+			static_assert(kGet == constexpr_hash_string(std::string_view("GET")));
+			static_assert(constexpr_hash_string_no_case("get") == constexpr_hash_string_no_case("GET"));
+			static_assert(constexpr_hash_string(L"GET") != kGet);
+			REQUIRE(hash_string(std::string("GET")) == kGet);
+			REQUIRE(hash_string(L"GET") == constexpr_hash_string(L"GET"));
+		}
+	}
+
+	GIVEN("hashed containers")
+	{
+		std::unordered_map<std::string, int, string_hash> counts;
+		std::unordered_set<std::string, string_hash_no_case, string_equal_no_case> headers = { "Content-Type", "Content-Length" };
+		++counts["a"];
+		++counts["a"];
+
+		THEN("the functors plug in")
+		{
+			REQUIRE(counts["a"] == 2);
+			REQUIRE(headers.count("content-type") == 1);
+			REQUIRE(headers.count("CONTENT-LENGTH") == 1);
+			REQUIRE(headers.count("Content-Encoding") == 0);
+		}
+	}
+}
+
+SCENARIO("no_case_map looks up strings ignoring case, without copying them")
+{
+	GIVEN("a few headers")
+	{
+		no_case_map<std::string> headers = { { "Content-Type", "text/html" }, { "Content-Length", "42" } };
+
+		THEN("any spelling finds them, and the first spelling is kept")
+		{
+			REQUIRE(headers.size() == 2);
+			REQUIRE(headers.contains("content-type"));
+			REQUIRE(headers.at("CONTENT-LENGTH") == "42");
+			REQUIRE(headers.find("Content-Encoding") == headers.end());
+			REQUIRE_THROWS_AS(headers.at("Host"), std::out_of_range);
+
+			auto found = headers.find("content-TYPE");
+			REQUIRE(found != headers.end());
+			REQUIRE(found.key() == "Content-Type");
+			REQUIRE(found.value() == "text/html");
+		}
+
+		THEN("inserting an existing key (in any case) doesn't replace it, unless asked to")
+		{
+			REQUIRE_FALSE(headers.try_emplace("CONTENT-TYPE", "text/plain").second);
+			REQUIRE(headers["content-type"] == "text/html");
+			REQUIRE_FALSE(headers.insert_or_assign("CONTENT-TYPE", "text/plain").second);
+			REQUIRE(headers["content-type"] == "text/plain");
+			REQUIRE(headers.size() == 2);
+			headers["Host"] = "example.com";
+			REQUIRE(headers.size() == 3);
+		}
+
+		THEN("iteration is in insertion order")
+		{
+			std::vector<std::string> keys;
+			for (auto [key, value] : headers)
+				keys.emplace_back(key);
+			REQUIRE(keys == std::vector<std::string>{ "Content-Type", "Content-Length" });
+		}
+	}
+
+	GIVEN("many keys, some erased")
+	{
+		no_case_map<int> map;
+		std::unordered_map<std::string, int> expected;
+		const auto lowercase = [](std::string key) { make_lowercase(key.data(), key.size()); return key; };
+		for (int i = 0; i < 5000; ++i)
+		{
+			const auto key = "Key-" + std::to_string(i * 7919 % 10007);
+			map[key] = i;
+			expected[lowercase(key)] = i;
+			if (i % 3 == 0)
+			{
+				const auto victim = "KEY-" + std::to_string(i / 3 * 7919 % 10007);
+				REQUIRE(map.erase(victim) == expected.erase(lowercase(victim)));
+			}
+		}
+
+		THEN("it agrees with a lower cased std::unordered_map")
+		{
+			REQUIRE(map.size() == expected.size());
+			for (const auto & [key, value] : expected)
+				REQUIRE(map.at(key) == value);
+			for (auto [key, value] : map)
+				REQUIRE(expected.at(lowercase(std::string(key))) == value);
+			REQUIRE(map.erase("no such key") == 0);
+		}
+
+		THEN("copies and clearing work")
+		{
+			auto copy = map;
+			map.clear();
+			REQUIRE(map.empty());
+			REQUIRE_FALSE(map.contains("key-0"));
+			REQUIRE(copy.size() == expected.size());
+			for (const auto & [key, value] : expected)
+				REQUIRE(copy.at(key) == value);
+		}
+
+		THEN("moving leaves an empty map, which can still be used")
+		{
+			auto moved = std::move(map);
+			REQUIRE(moved.size() == expected.size());
+			REQUIRE(map.empty());
+			REQUIRE_FALSE(map.contains("key-0"));
+			map["x"] = 1;
+			REQUIRE(map.at("X") == 1);
+
+			map = std::move(moved);
+			REQUIRE(map.size() == expected.size());
+			REQUIRE_FALSE(moved.contains("x"));
+			moved["y"] = 2;
+			REQUIRE(moved.size() == 1);
+		}
+	}
+
+	GIVEN("wide strings")
+	{
+		wno_case_map<int> map;
+		map[L"Alpha"] = 1;
+
+		THEN("they work the same")
+		{
+			REQUIRE(map.at(L"ALPHA") == 1);
+			REQUIRE(map.count(L"beta") == 0);
+		}
+	}
+}
+
+SCENARIO("perfect_set finds constant keys with a perfect hash built by the compiler")
+{
+	GIVEN("a set of keywords")
+	{
+		static constexpr const char * kWords[] = {
+			"alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char", "class", "const", "constexpr",
+			"const_cast", "continue", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit",
+			"export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace",
+			"new", "noexcept", "not", "nullptr", "operator", "or", "private", "protected", "public", "register", "reinterpret_cast",
+			"return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this",
+			"thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+			"volatile", "wchar_t", "while", "xor",
+		};
+		static constexpr auto kKeywords = make_perfect_set(kWords);
+
+		THEN("every keyword is found at its index, and nothing else is found")
+		{
+			static_assert(kKeywords.size() == std::size(kWords));
+			for (size_t i = 0; i < countof(kWords); ++i)
+			{
+				REQUIRE(kKeywords.find(kWords[i]) == i);
+				REQUIRE(kKeywords.find(std::string(kWords[i]) + "_") == kKeywords.npos);
+				REQUIRE(kKeywords.find("_" + std::string(kWords[i])) == kKeywords.npos);
+			}
+			REQUIRE(kKeywords.find("") == kKeywords.npos);
+			REQUIRE(kKeywords.find("While") == kKeywords.npos);
+			REQUIRE_FALSE(kKeywords.contains("identifier"));
+		}
+
+		THEN("indexes can be case labels")
+		{
+			const auto classify = [](std::string_view token) {
+				switch (kKeywords.find(token))
+				{
+				case kKeywords.index_of("if"): return 1;
+				case kKeywords.index_of("while"): return 2;
+				case kKeywords.npos: return 0;
+				default: return -1;
+				}
+			};
+			REQUIRE(classify("if") == 1);
+			REQUIRE(classify("while") == 2);
+			REQUIRE(classify("for") == -1);
+			REQUIRE(classify("x") == 0);
+		}
+	}
+
+	GIVEN("a set which ignores case")
+	{
+		static constexpr auto kMethods = make_perfect_set_no_case({ "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS" });
+
+		THEN("any spelling matches")
+		{
+			REQUIRE(kMethods.find("get") == 0);
+			REQUIRE(kMethods.find("Options") == 5);
+			REQUIRE(kMethods.find("PATCH") == kMethods.npos);
+			static_assert(kMethods.index_of("delete") == 4);
+		}
+	}
+
+	GIVEN("sets of integers, and of wide strings")
+	{
+		constexpr auto kPorts = make_perfect_set({ 80, 443, 8080, 8443, 0, -1 });
+		static constexpr auto kWide = make_perfect_set({ L"yes", L"no" });
+
+		THEN("lookups of integers work at compile time too")
+		{
+			static_assert(kPorts.find(8080) == 2);
+			static_assert(isoneof(0, kPorts) && isoneof(-1, kPorts) && !isoneof(1, kPorts));
+			static_assert(isoneof(3, 1, 2, 3) && !isoneof(4, { 1, 2, 3 }));
+			for (int port = -100; port < 10000; ++port)
+				REQUIRE(isoneof(port, kPorts) == isoneof(port, { 80, 443, 8080, 8443, 0, -1 }));
+			REQUIRE(kWide.find(L"no") == 1);
+			REQUIRE(kWide.find(L"maybe") == kWide.npos);
+		}
+	}
+}
+
+SCENARIO("parallel_sort sorts across threads, and parallel_sort_strings sorts strings by their cached prefixes")
+{
+	GIVEN("enough numbers to be split between threads")
+	{
+		std::vector<uint32_t> numbers(200000);
+		uint32_t x = 1;
+		for (auto & n : numbers)
+			n = (x = x * 1103515245 + 12345) >> 8;
+
+		THEN("they sort as std::sort sorts them, whatever the number of threads")
+		{
+			auto expected = numbers;
+			std::sort(expected.begin(), expected.end(), std::greater<>());
+			for (unsigned threads : { 1, 2, 3, 7, 0 })
+			{
+				auto sorted = numbers;
+				parallel_sort(sorted.begin(), sorted.end(), std::greater<>(), threads);
+				REQUIRE(sorted == expected);
+			}
+		}
+
+		THEN("a throwing comparison is rethrown")
+		{
+			REQUIRE_THROWS_AS(parallel_sort(numbers.begin(), numbers.end(), [](uint32_t, uint32_t) -> bool { throw std::runtime_error("incomparable"); }, 4), std::runtime_error);
+		}
+
+		THEN("comparisons may take non-const references, as std::sort's may")
+		{
+			struct record { uint32_t id; };
+			std::vector<record> records;
+			for (auto n : numbers)
+				records.push_back({ n });
+			parallel_sort(records.begin(), records.end(), [](auto & a, auto & b) { return a.id < b.id; }, 4);
+			REQUIRE(std::is_sorted(records.begin(), records.end(), [](auto & a, auto & b) { return a.id < b.id; }));
+		}
+	}
+
+	GIVEN("strings which often share long prefixes, and differ in case")
+	{
+		std::vector<std::string> names;
+		uint32_t x = 7;
+		for (int i = 0; i < 100000; ++i)
+		{
+			x = x * 1103515245 + 12345;
+			std::string name = (x >> 28) & 1 ? "C:\\Windows\\System32\\" : "c:\\windows\\";
+			name.resize(name.size() * ((x >> 24) & 3) / 3);
+			for (auto n = (x >> 16) % 12; n; --n)
+				name += "aBz_9\x80\xFF "[(x >> (n + 3)) % 8];
+			names.push_back(name);
+		}
+
+		THEN("they sort as compare() and compare_no_case() order them")
+		{
+			auto expected = names;
+			std::sort(expected.begin(), expected.end(), [](const std::string & a, const std::string & b) { return compare(std::string_view(a), std::string_view(b)) < 0; });
+			auto sorted = names;
+			parallel_sort_strings(sorted.begin(), sorted.end(), case_sensitivity::sensitive, 4);
+			REQUIRE(sorted == expected);
+			sorted = names;
+			parallel_sort(sorted.begin(), sorted.end(), std::less<>(), 5);
+			REQUIRE(sorted == expected);
+
+			std::stable_sort(expected.begin(), expected.end(), [](const std::string & a, const std::string & b) { return compare_no_case(std::string_view(a), std::string_view(b)) < 0; });
+			std::vector<std::string_view> views(names.begin(), names.end());
+			parallel_sort_strings(views.begin(), views.end(), case_sensitivity::no_case);
+			REQUIRE(views.size() == expected.size());
+			for (size_t i = 0; i < views.size(); ++i)
+				REQUIRE(compare_no_case(views[i], std::string_view(expected[i])) == 0);
+		}
+
+		THEN("wide strings and pointers sort too")
+		{
+			std::vector<std::wstring> wide;
+			for (size_t i = 0; i < 1000; ++i)
+			{
+				wide.emplace_back();
+				for (auto c : names[i])
+					wide.back() += wchar_t(uint8_t(c));
+			}
+			auto expected = wide;
+			std::sort(expected.begin(), expected.end());
+			parallel_sort_strings(wide.begin(), wide.end());
+			REQUIRE(wide == expected);
+
+			// (with units which have the top bit set, which compare() orders as signed wherever wchar_t is)
+			std::vector<std::wstring> high;
+			const wchar_t units[] = { L'a', L'Z', wchar_t(0x7F), wchar_t(~0x7F), wchar_t(-1), std::numeric_limits<wchar_t>::max(), std::numeric_limits<wchar_t>::min() };
+			for (size_t i = 0; i < 2000; ++i)
+			{
+				high.emplace_back();
+				for (auto n = 1 + i % 11; n; --n)
+					high.back() += units[(i * 7 + n * n) % std::size(units)];
+			}
+			for (const auto sensitivity : { case_sensitivity::sensitive, case_sensitivity::no_case })
+			{
+				const auto less = [sensitivity](const std::wstring & a, const std::wstring & b) {
+					return (sensitivity == case_sensitivity::no_case ? compare_no_case(std::wstring_view(a), std::wstring_view(b)) : compare(std::wstring_view(a), std::wstring_view(b))) < 0;
+				};
+				auto sorted = high;
+				parallel_sort_strings(sorted.begin(), sorted.end(), sensitivity);
+				REQUIRE(std::is_sorted(sorted.begin(), sorted.end(), less));
+			}
+
+			std::vector<const char *> pointers = { "b", "B", "a", "", "ab" };
+			parallel_sort_strings(pointers.begin(), pointers.end(), case_sensitivity::no_case);
+			REQUIRE(std::string(pointers[0]).empty());
+			REQUIRE(pointers[1] == std::string("a"));
+			REQUIRE(pointers[2] == std::string("ab"));
+		}
+	}
+}
+
+SCENARIO("sort_strings sorts strings by their characters, as compare() and compare_no_case() order them")
+{
+	GIVEN("strings of all sorts: sharing prefixes, differing in case, with high and null characters")
+	{
+		std::vector<std::string> strings;
+		uint32_t x = 3;
+		for (int i = 0; i < 50000; ++i)
+		{
+			x = x * 1103515245 + 12345;
+			std::string s = (x >> 29) & 1 ? "prefix/shared/by/many/" : "";
+			for (auto n = (x >> 16) % 9; n; --n)
+			{
+				x = x * 1103515245 + 12345;
+				s += "aAzZ_@[`{09\x80\xFF"[(x >> 20) % 14];
+			}
+			if (i % 97 == 0)
+				s += '\0';
+			strings.push_back(s);
+		}
+
+		THEN("they sort as compare() orders them, both as a whole and in small buckets")
+		{
+			for (size_t count : { strings.size(), size_t(500), size_t(10) })
+			{
+				std::vector<std::string> sorted(strings.begin(), strings.begin() + count);
+				auto expected = sorted;
+				std::sort(expected.begin(), expected.end(), [](const std::string & a, const std::string & b) { return compare(std::string_view(a), std::string_view(b)) < 0; });
+				sort_strings(sorted.begin(), sorted.end());
+				REQUIRE(sorted == expected);
+			}
+		}
+
+		THEN("they sort as compare_no_case() orders them")
+		{
+			for (size_t count : { strings.size(), size_t(500) })
+			{
+				std::vector<std::string_view> sorted(strings.begin(), strings.begin() + count);
+				sort_strings(sorted.begin(), sorted.end(), case_sensitivity::no_case);
+				for (size_t i = 1; i < sorted.size(); ++i)
+					REQUIRE(compare_no_case(sorted[i - 1], sorted[i]) <= 0);
+			}
+		}
+
+		THEN("wide strings and pointers sort too")
+		{
+			std::vector<std::wstring> wide;
+			for (size_t i = 0; i < 5000; ++i)
+			{
+				wide.emplace_back();
+				for (auto c : strings[i])
+					wide.back() += wchar_t(c);
+			}
+			auto expected = wide;
+			std::sort(expected.begin(), expected.end());
+			sort_strings(wide.begin(), wide.end());
+			REQUIRE(wide == expected);
+
+			std::sort(expected.begin(), expected.end(), [](const std::wstring & a, const std::wstring & b) { return compare_no_case(std::wstring_view(a), std::wstring_view(b)) < 0; });
+			sort_strings(wide.begin(), wide.end(), case_sensitivity::no_case);
+			for (size_t i = 0; i < wide.size(); ++i)
+				REQUIRE(compare_no_case(std::wstring_view(wide[i]), std::wstring_view(expected[i])) == 0);
+
+			std::vector<const char *> pointers = { "b", "B", "a", "", "ab", nullptr };
+			sort_strings(pointers.begin(), pointers.end());
+			REQUIRE(std::string(StringOrBlank(pointers[1])).empty());
+			REQUIRE(pointers[2] == std::string("B"));
+			REQUIRE(pointers[5] == std::string("b"));
+		}
+	}
+
+	GIVEN("very long strings: many copies of one, and a long chain of prefixes")
+	{
+		THEN("they sort without running out of stack")
+		{
+			std::vector<std::string> copies(100, std::string(200000, 'x'));
+			copies[50].back() = 'w';
+			sort_strings(copies.begin(), copies.end());
+			REQUIRE(copies[0].back() == 'w');
+			REQUIRE(std::is_sorted(copies.begin(), copies.end()));
+
+			for (size_t count : { size_t(3000), size_t(500) })
+			{
+				std::vector<std::string> chain;
+				for (size_t i = 1; i <= count; ++i)
+					chain.push_back(std::string(i, 'a'));
+				auto expected = chain;
+				uint32_t x = 5;
+				for (size_t i = chain.size() - 1; i; --i)
+				{
+					x = x * 1103515245 + 12345;
+					std::swap(chain[i], chain[(x >> 8) % (i + 1)]);
+				}
+				sort_strings(chain.begin(), chain.end(), case_sensitivity::no_case);
+				REQUIRE(chain == expected);
+			}
+		}
+	}
+}
+
+SCENARIO("packed_strings keeps strings in one buffer, and saves an image which can be used in place")
+{
+	GIVEN("some strings, added one at a time, from a split, and from a vector")
+	{
+		packed_strings strings;
+		strings.push_back("readme.txt");
+		strings.push_back("");
+		strings.push_back(std::string("a\0b", 3));
+		strings.append(split(std::string_view("one;;two;three"), ";", empty_fields::skip));
+		strings.append(std::vector<std::string>{ "x", "yz" });
+
+		THEN("they're all there, in order, each null terminated")
+		{
+			const std::vector<std::string_view> expected = { "readme.txt", "", std::string_view("a\0b", 3), "one", "two", "three", "x", "yz" };
+			REQUIRE(strings.size() == expected.size());
+			REQUIRE(std::equal(strings.begin(), strings.end(), expected.begin(), expected.end()));
+			REQUIRE(strings.end() - strings.begin() == 8);
+			REQUIRE(strings.begin()[5] == "three");
+			REQUIRE(strings[0] == "readme.txt");
+			REQUIRE(strings.front() == "readme.txt");
+			REQUIRE(strings.back() == "yz");
+			REQUIRE(strings.c_str(3) == std::string("one"));
+			REQUIRE(strings.c_str(1)[0] == '\0');
+			REQUIRE(strings.characters() == 10 + 0 + 3 + 3 + 3 + 5 + 1 + 2 + 8);
+			REQUIRE_THROWS_AS(strings.at(8), std::out_of_range);
+		}
+
+		THEN("they can be removed")
+		{
+			strings.pop_back();
+			REQUIRE(strings.size() == 7);
+			REQUIRE(strings.back() == "x");
+			strings.push_back("again");
+			REQUIRE(strings.back() == "again");
+			strings.clear();
+			REQUIRE(strings.empty());
+			REQUIRE(strings.begin() == strings.end());
+			REQUIRE(strings.characters() == 0);
+		}
+
+		THEN("they can be saved and loaded, or viewed in place")
+		{
+			std::ostringstream out;
+			strings.save(out);
+			const auto image = out.str();
+			REQUIRE(image.size() == 16 + 4 * (strings.size() + 1) + strings.characters());
+
+			std::istringstream in(image);
+			const auto loaded = packed_strings::load(in);
+			REQUIRE(loaded == strings);
+
+			// (as a memory mapped file would be, aligned)
+			std::vector<uint32_t> mapped((image.size() + 3) / 4);
+			std::memcpy(mapped.data(), image.data(), image.size());
+			const auto view = packed_strings_view::from_image(mapped.data(), image.size());
+			REQUIRE(view == strings.view());
+			REQUIRE(std::equal(view.begin(), view.end(), strings.begin(), strings.end()));
+			REQUIRE(view.c_str(5) == std::string("three"));
+			REQUIRE(packed_strings(view) == strings);
+		}
+
+		THEN("invalid images are rejected")
+		{
+			std::ostringstream out;
+			strings.save(out);
+			const auto image = out.str();
+			std::vector<uint32_t> mapped((image.size() + 3) / 4);
+			std::memcpy(mapped.data(), image.data(), image.size());
+
+			// truncated, of the wrong character size, or with out of order offsets
+			REQUIRE_THROWS_AS(packed_strings_view::from_image(mapped.data(), image.size() - 1), std::runtime_error);
+			REQUIRE_THROWS_AS(packed_strings_view::from_image(mapped.data(), 12), std::runtime_error);
+			REQUIRE_THROWS_AS(wpacked_strings_view::from_image(mapped.data(), image.size()), std::runtime_error);
+			std::swap(mapped[4 + 2], mapped[4 + 3]);
+			REQUIRE_THROWS_AS(packed_strings_view::from_image(mapped.data(), image.size()), std::runtime_error);
+
+			std::istringstream in(image.substr(0, image.size() - 1));
+			REQUIRE_THROWS_AS(packed_strings::load(in), std::runtime_error);
+		}
+
+		THEN("images with a string's terminator overwritten, or impossibly large counts, are rejected")
+		{
+			std::ostringstream out;
+			strings.save(out);
+			auto image = out.str();
+			image[16 + 4 * (strings.size() + 1) + 10] = 'X';		// (after "readme.txt")
+			std::vector<uint32_t> mapped((image.size() + 3) / 4);
+			std::memcpy(mapped.data(), image.data(), image.size());
+			REQUIRE_THROWS_AS(packed_strings_view::from_image(mapped.data(), image.size()), std::runtime_error);
+			std::istringstream damaged(image);
+			REQUIRE_THROWS_AS(packed_strings::load(damaged), std::runtime_error);
+
+			image = out.str();
+			const uint32_t huge = 0xFFFFFFF0;
+			std::memcpy(&image[8], &huge, sizeof(huge));
+			std::memcpy(&image[12], &huge, sizeof(huge));
+			std::istringstream truncated(image);
+			REQUIRE_THROWS_AS(packed_strings::load(truncated), std::runtime_error);
+		}
+
+		THEN("moving leaves an empty array, which can still be used")
+		{
+			auto moved = std::move(strings);
+			REQUIRE(moved.size() == 8);
+			REQUIRE(strings.empty());
+			REQUIRE(strings.size() == 0);
+			REQUIRE(strings.begin() == strings.end());
+			strings.push_back("again");
+			REQUIRE(strings.size() == 1);
+			REQUIRE(strings[0] == "again");
+
+			strings = std::move(moved);
+			REQUIRE(strings.size() == 8);
+			REQUIRE(moved.empty());
+			moved.push_back("more");
+			REQUIRE(moved.back() == "more");
+		}
+	}
+
+	GIVEN("wide strings, and none at all")
+	{
+		wpacked_strings wide = { L"alpha", L"beta" };
+		packed_strings none;
+
+		THEN("they work the same way")
+		{
+			REQUIRE(wide[1] == L"beta");
+			REQUIRE(wide.c_str(0) == std::wstring(L"alpha"));
+
+			std::ostringstream out;
+			wide.save(out);
+			std::istringstream in(out.str());
+			REQUIRE(wpacked_strings::load(in) == wide);
+
+			REQUIRE(none.empty());
+			REQUIRE(none.view().empty());
+			REQUIRE(packed_strings_view().size() == 0);
+			REQUIRE(packed_strings_view() == none.view());
+		}
+	}
+}
+
+SCENARIO("alphanumcmp() compares runs of digits as numbers, and alphanumkey() makes keys which sort the same way")
+{
+	GIVEN("numbers of any length")
+	{
+		THEN("they compare by value, however many digits they have")
+		{
+			REQUIRE(Toolbox::alphanumcmp("file9", "file10") < 0);
+			REQUIRE(Toolbox::alphanumcmp("file10", "file9") > 0);
+			REQUIRE(Toolbox::alphanumcmp("x18446744073709551616", "x18446744073709551615") > 0);		// (2^64, which overflowed)
+			REQUIRE(Toolbox::alphanumcmp("x100000000000000000000000000000", "x99") > 0);
+			REQUIRE(Toolbox::alphanumcmp("x123456789012345678901234567890a", "x123456789012345678901234567891a") < 0);
+			REQUIRE(Toolbox::alphanumcmp("x0007", "x7") == 0);
+			REQUIRE(Toolbox::alphanumcmp("x0007b", "x7a") > 0);
+			REQUIRE(Toolbox::alphanumcmp(L"v2.10", L"v2.9") > 0);
+		}
+
+		THEN("other characters compare as unsigned values (and the i versions ignore case), with digits first")
+		{
+			REQUIRE(Toolbox::alphanumcmp("a", "b") < 0);
+			REQUIRE(Toolbox::alphanumcmp("b", "a") > 0);
+			REQUIRE(Toolbox::alphanumcmp("z", "\xE9") < 0);
+			REQUIRE(Toolbox::alphanumcmp("B", "a") < 0);
+			REQUIRE(Toolbox::alphanumcmpi("B", "a") > 0);
+			REQUIRE(Toolbox::alphanumcmpi("ABC10", "abc10") == 0);
+			REQUIRE(Toolbox::alphanumcmp("1", "a") < 0);
+			REQUIRE(Toolbox::alphanumcmp("ab", "a") > 0);
+		}
+	}
+
+	GIVEN("many strings, mixing letters (of both cases) with numbers (some with leading zeros)")
+	{
+		std::vector<std::string> strings;
+		uint32_t x = 11;
+		const auto next = [&x](uint32_t n) { x = x * 1103515245 + 12345; return (x >> 16) % n; };
+		for (int i = 0; i < 400; ++i)
+		{
+			std::string s;
+			for (auto n = next(5); n; --n)
+			{
+				if (next(2))
+					s += "aAbB_~\xE9"[next(7)];
+				else
+				{
+					s.append(next(3), '0');
+					for (auto digits = 1 + next(25); digits; --digits)
+						s += char('0' + next(10));
+				}
+			}
+			strings.push_back(s);
+		}
+
+		THEN("the keys, compared as bytes, order them as alphanumcmp() and alphanumcmpi() do")
+		{
+			const auto sign = [](int n) { return (n > 0) - (n < 0); };
+			for (const auto & a : strings)
+			{
+				const auto key_a = Toolbox::alphanumkey(a), keyi_a = Toolbox::alphanumkeyi(a);
+				const auto wide_a = std::wstring(a.begin(), a.end());
+				for (const auto & b : strings)
+				{
+					const auto wide_b = std::wstring(b.begin(), b.end());
+					REQUIRE(sign(key_a.compare(Toolbox::alphanumkey(b))) == sign(Toolbox::alphanumcmp(a.c_str(), b.c_str())));
+					REQUIRE(sign(keyi_a.compare(Toolbox::alphanumkeyi(b))) == sign(Toolbox::alphanumcmpi(a.c_str(), b.c_str())));
+					REQUIRE(sign(Toolbox::alphanumkey(wide_a).compare(Toolbox::alphanumkey(wide_b))) == sign(Toolbox::alphanumcmp(wide_a.c_str(), wide_b.c_str())));
+				}
+			}
+		}
+	}
+}
+
 SCENARIO("...")
 {
 }